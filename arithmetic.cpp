@@ -165,6 +165,30 @@ private:
 			}
 			ans = hugeint::pow(params[0], params[1]);
 		}
+		else if (str == "powmod") {
+			if (params.size() != 3) {
+				message = "Function \'powmod\' only accepts 3 parameters";
+				error_id = 7;
+				return 0;
+			}
+			ans = hugeint::powMod(params[0], params[1], params[2]);
+		}
+		else if (str == "invmod") {
+			if (params.size() != 2) {
+				message = "Function \'invmod\' only accepts 2 parameters";
+				error_id = 7;
+				return 0;
+			}
+			ans = hugeint::invertMod(params[0], params[1]);
+		}
+		else if (str == "nextprime") {
+			if (params.size() != 1) {
+				message = "Function \'nextprime\' only accepts 1 parameter";
+				error_id = 7;
+				return 0;
+			}
+			ans = hugeint::nextPrime(params[0]);
+		}
 		else if (str == "sqrt") {
 			if (params.size() != 1) {
 				message = "Function \'sqrt\' only accepts 1 parameter";
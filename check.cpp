@@ -0,0 +1,71 @@
+#include <iostream>
+#include <chrono>
+
+#include "hugeint.h"
+
+// Checks properties of the algorithms that only run above their thresholds, so the ones small inputs never reach.
+// Prints every check and returns 1 if any of them failed. Usage: check
+
+#ifdef DIGIT_64
+const size_t digit_bits = 64;
+#else
+const size_t digit_bits = 32;
+#endif
+
+bool report (const std::string &name, bool passed) {
+	std::cout << name << ": " << (passed ? "ok" : "FAILED") << std::endl;
+	return passed;
+}
+
+// Cofactors of gcdext above half_gcd_threshold, where they are mapped back through the half gcd matrix, must still
+// be the minimal ones
+bool checkGcdext () {
+	size_t size = hugeint::half_gcd_threshold * 3;
+	for (int round = 0; round < 20; round++) {
+		hugeint common = hugeint::rand((round % 4) * size * digit_bits / 8 + 1, false);
+		hugeint lhs = hugeint::rand(size * digit_bits, true) * common;
+		hugeint rhs = hugeint::rand((size - round * size / 40) * digit_bits, true) * common;
+		hugeint s, t, gcd = hugeint::gcdext(lhs, rhs, s, t);
+		if (s * lhs + t * rhs != gcd || gcd != hugeint::gcd(lhs, rhs)) {
+			return false;
+		}
+		if (hugeint::abs(s) * gcd * 2 > hugeint::abs(rhs) || hugeint::abs(t) * gcd * 2 > hugeint::abs(lhs)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+double seconds (std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration <double>(std::chrono::steady_clock::now() - start).count();
+}
+// isProbablePrime of a number with no small factor is about one modular exponentiation on the same reduction
+// context as powMod, also from montgomery_threshold digits up, where Barrett reduction takes over
+bool checkPrimeTime () {
+	size_t size = std::max(hugeint::montgomery_threshold, (size_t)1024);
+	hugeint num;
+	bool small_factor = true;
+	while (small_factor) {
+		num = hugeint::rand(size * digit_bits, false) | 1;
+		small_factor = false;
+		for (int prime = 3; prime < 1000 && !small_factor; prime += 2) {
+			small_factor = num % prime == 0;
+		}
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	hugeint::powMod(hugeint(2), num - 1, num);
+	double pow_time = seconds(start);
+	start = std::chrono::steady_clock::now();
+	bool prime = num.isProbablePrime();
+	double prime_time = seconds(start);
+	std::cout << "isProbablePrime " << prime_time << " s, powMod " << pow_time << " s at " << size << " digits" << std::endl;
+	// A prime gets the Lucas test too, which costs a few more exponentiations
+	return prime || prime_time < pow_time * 1.5;
+}
+
+int main () {
+	bool passed = true;
+	passed &= report("gcdext cofactors above half_gcd_threshold", checkGcdext());
+	passed &= report("isProbablePrime time above montgomery_threshold", checkPrimeTime());
+	return passed ? 0 : 1;
+}
@@ -3,11 +3,13 @@
 #include <iostream> //overload of << and >>
 #include <string>
 #include <vector>
+#include <memory> // unique_ptr
 #include <cstdint>
 #include <type_traits> // enable_if
 
 // #define DIGIT_64 // Uncomment this to enable manual 64 bit digit size
 // #define DIGIT_32 // Uncomment this to enable manual 32 bit digit size
+// #define NO_ASM // Uncomment this to disable the x86-64 assembly and vector kernels
 
 #ifndef DIGIT_64
 #ifndef DIGIT_32
@@ -27,19 +29,31 @@ template <typename Integer, typename = std::enable_if <!std::is_integral <Intege
 
 #define COMPARE(op_name, implement) \
 friend bool operator op_name (const hugeint &lhs, const hugeint &rhs) { return implement; } \
-NOT_HUGEINT_TEMP friend bool operator op_name (const hugeint &lhs, const NotHugeint &rhs) { return lhs op_name (hugeint)rhs; } \
-NOT_HUGEINT_TEMP friend bool operator op_name (const NotHugeint &lhs, const hugeint &rhs) { return (hugeint)lhs op_name rhs; }
+NOT_HUGEINT_TEMP friend bool operator op_name (const hugeint &lhs, const NotHugeint &rhs) { return lhs op_name toOperand(rhs); } \
+NOT_HUGEINT_TEMP friend bool operator op_name (const NotHugeint &lhs, const hugeint &rhs) { return toOperand(lhs) op_name rhs; }
 
 #define OPERATION(op_name, implement) \
 friend hugeint operator op_name (const hugeint &lhs, const hugeint &rhs) { return implement; } \
-NOT_HUGEINT_TEMP friend hugeint operator op_name (const hugeint &lhs, const NotHugeint &rhs) { return lhs op_name (hugeint)rhs; } \
-NOT_HUGEINT_TEMP friend hugeint operator op_name (const NotHugeint &lhs, const hugeint &rhs) { return (hugeint)lhs op_name rhs; }
+NOT_HUGEINT_TEMP friend hugeint operator op_name (const hugeint &lhs, const NotHugeint &rhs) { return lhs op_name toOperand(rhs); } \
+NOT_HUGEINT_TEMP friend hugeint operator op_name (const NotHugeint &lhs, const hugeint &rhs) { return toOperand(lhs) op_name rhs; }
 
 #define ASSIGN(op_name, implement) \
 friend hugeint &operator op_name (hugeint &lhs, const hugeint &rhs) { implement; return lhs; } \
-NOT_HUGEINT_TEMP friend hugeint &operator op_name (hugeint &lhs, const NotHugeint &rhs) { return lhs op_name (hugeint)rhs; } \
+NOT_HUGEINT_TEMP friend hugeint &operator op_name (hugeint &lhs, const NotHugeint &rhs) { return lhs op_name toOperand(rhs); } \
 NOT_HUGEINT_TEMP friend NotHugeint &operator op_name (NotHugeint &lhs, const hugeint &rhs) { return lhs op_name (NotHugeint)rhs; }
 
+// Overloads for integers that fit in a digit, which toOperand passes as a scalar_t instead of converting them
+#define COMPARE_SCALAR(op_name) \
+friend bool operator op_name (const hugeint &lhs, scalar_t rhs) { return lhs.compareScalar(rhs) op_name 0; } \
+friend bool operator op_name (scalar_t lhs, const hugeint &rhs) { return 0 op_name rhs.compareScalar(lhs); }
+
+#define OPERATION_SCALAR(op_name, implement) \
+friend hugeint operator op_name (const hugeint &lhs, scalar_t rhs) { return implement; } \
+friend hugeint operator op_name (scalar_t lhs, const hugeint &rhs) { return implement; }
+
+#define ASSIGN_SCALAR(op_name, implement) \
+friend hugeint &operator op_name (hugeint &lhs, scalar_t rhs) { implement; return lhs; }
+
 class hugeint {
 private:
 #ifdef DIGIT_64
@@ -65,8 +79,37 @@ private:
 	bool neg = false;
 	std::vector <digit_t> digits;
 
+	// An integer that fits in a digit, stored like a hugeint with at most one digit
+	struct scalar_t {
+		digit_t val;
+		bool neg;
+		digit_t abs () const {
+			return neg ? 0 - val : val;
+		}
+	};
+	// bool takes the hugeint conversion, val < 0 means nothing for it
+	template <typename Type>
+	static typename std::enable_if <std::is_integral <Type>::value && !std::is_same <Type, bool>::value && sizeof(Type) <= sizeof(digit_t), scalar_t>::type toOperand (const Type &val) {
+		return scalar_t {(digit_t)val, std::is_signed <Type>::value && val < 0};
+	}
+	template <typename Type>
+	static typename std::enable_if <!(std::is_integral <Type>::value && !std::is_same <Type, bool>::value && sizeof(Type) <= sizeof(digit_t)), hugeint>::type toOperand (const Type &val) {
+		return (hugeint)val;
+	}
+	explicit hugeint (scalar_t to_copy);
+
+public:
+	// Rounding of the quotient of divmod. round_trunc goes toward 0 like /, round_floor toward negative infinity and
+	// round_ceil toward positive infinity
+	enum round_t {
+		round_trunc,
+		round_floor,
+		round_ceil,
+	};
+
 	// ----- Casting functions -----
 private:
+	static void writeDec (std::string &ans, hugeint &num, const std::vector <hugeint> &powers, size_t level, size_t width);
 	size_t fromHex (const std::string::const_iterator &begin, const std::string::const_iterator &end);
 	size_t fromDec (const std::string::const_iterator &begin, const std::string::const_iterator &end);
 	size_t fromOct (const std::string::const_iterator &begin, const std::string::const_iterator &end);
@@ -141,6 +184,10 @@ private:
 	void clearZeros ();
 	void resize (size_t new_size);
 	void invert ();
+	void addDigit (digit_t val);
+	void subtractDigit (digit_t val);
+	void multiplyDigit (digit_t val);
+	digit_t divideDigit (digit_t divisor);
 
 public:
 	size_t size () const;
@@ -154,6 +201,7 @@ public:
 	// operator calculation functions
 private:
 	bool compareSml (const hugeint &to_comp) const;
+	int compareScalar (scalar_t to_comp) const;
 
 	static hugeint calculateAnd (const hugeint &lhs, const hugeint &rhs);
 	void calculateAnd (const hugeint &rhs);
@@ -172,32 +220,173 @@ private:
 
 	static hugeint calculateAdd (const hugeint &lhs, const hugeint &rhs, const bool diff = false);
 	void calculateAdd (const hugeint &rhs, const bool diff = false);
-
-	static hugeint simpleMult (std::vector <digit_t>::iterator begin1, std::vector <digit_t>::iterator end1,
-	                           std::vector <digit_t>::iterator begin2, std::vector <digit_t>::iterator end2);
-	static hugeint addKaratsuba (std::vector <digit_t>::iterator begin1, std::vector <digit_t>::iterator end1,
-	                             std::vector <digit_t>::iterator begin2, std::vector <digit_t>::iterator end2);
-	static hugeint karatsuba (std::vector <digit_t>::iterator begin1, std::vector <digit_t>::iterator end1,
-	                          std::vector <digit_t>::iterator begin2, std::vector <digit_t>::iterator end2, size_t block_size);
-	static hugeint multAlgorithm (std::vector <digit_t>::iterator begin1, std::vector <digit_t>::iterator end1,
-	                              std::vector <digit_t>::iterator begin2, std::vector <digit_t>::iterator end2, size_t block_size);
+	static hugeint calculateAdd (const hugeint &lhs, scalar_t rhs, const bool diff = false);
+	static hugeint calculateAdd (scalar_t lhs, const hugeint &rhs, const bool diff = false);
+	void calculateAdd (scalar_t rhs, const bool diff = false);
+
+	// Functions on raw digit spans. Results never overlap inputs unless stated otherwise
+	static digit_t addDigits (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size);
+	static digit_t subDigits (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size);
+	static bool lessDigits (const digit_t *lhs, const digit_t *rhs, size_t size);
+	static bool subAbsDigits (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size);
+	static digit_t multDigit (digit_t *res, const digit_t *lhs, size_t size, digit_t rhs);
+	static digit_t addMultDigit (digit_t *res, const digit_t *lhs, size_t size, digit_t rhs);
+	static digit_t subMultDigit (digit_t *res, const digit_t *lhs, size_t size, digit_t rhs);
+	static digit_t invertDigit (digit_t div);
+	static digit_t invertTwoDigits (digit_t div1, digit_t div0);
+	static digit_t divStep (digit_t &rem, digit_t low, digit_t div, digit_t inv);
+	static digit_t divStep (double_t &rem, digit_t low, double_t div, digit_t inv);
+	static digit_t divDigit (digit_t *res, const digit_t *lhs, size_t size, digit_t rhs);
+	static digit_t modDigit (const digit_t *lhs, size_t size, digit_t rhs);
+	static void divTwoDigits (digit_t *res, const digit_t *lhs, size_t size, const digit_t *rhs, digit_t *rem);
+	static digit_t invertOdd (digit_t val);
+	static void divExactDigit (digit_t *res, const digit_t *lhs, size_t size, digit_t rhs);
+	static digit_t shiftFwdDigits (digit_t *res, const digit_t *src, size_t size, int shift);
+	static void shiftBackDigits (digit_t *res, const digit_t *src, size_t size, int shift);
+
+	static void simpleMult (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size);
+	static void simpleSquare (digit_t *res, const digit_t *num, size_t size);
+	static void karatsuba (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size, digit_t *scratch);
+	static void unbalancedMult (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size, digit_t *scratch);
+	static void karatsubaSquare (digit_t *res, const digit_t *num, size_t size, digit_t *scratch);
+	static void toom3 (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size, digit_t *scratch);
+	static void toom4 (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size, digit_t *scratch);
+#ifdef DIGIT_64
+	static void nttMult (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size);
+#endif
+	static size_t multScratch (size_t size1, size_t size2);
+	// One product of a recursion level, the products of a level don't depend on each other
+	struct product_t {
+		digit_t *res;
+		const digit_t *lhs;
+		size_t lhs_size;
+		const digit_t *rhs;
+		size_t rhs_size;
+	};
+	static void multProducts (const product_t *prods, size_t count, digit_t *scratch);
+	static void multAlgorithm (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size, digit_t *scratch);
+	static void squareAlgorithm (digit_t *res, const digit_t *num, size_t size, digit_t *scratch);
+	static hugeint calculateSquare (const hugeint &num);
 	static hugeint calculateMult (const hugeint &lhs, const hugeint &rhs);
-
-	static hugeint simpleDiv (hugeint lhs, hugeint rhs, bool rem = false);
+	static hugeint calculateMult (const hugeint &lhs, scalar_t rhs);
+	static hugeint calculateMult (scalar_t lhs, const hugeint &rhs);
+	void calculateMult (scalar_t rhs);
+
+	// Division on raw digit spans. div is normalized (its top bit is set), rem holds the dividend and is left with the
+	// remainder in its low div_size digits, quot gets rem_size - div_size digits and the top quotient digit is returned
+	static digit_t simpleDiv (digit_t *quot, digit_t *rem, size_t rem_size, const digit_t *div, size_t div_size);
+	static digit_t burnikelZiegler (digit_t *quot, digit_t *rem, const digit_t *div, size_t size, digit_t *scratch);
+	static void invertDigits (digit_t *inv, const digit_t *div, size_t size, digit_t *scratch);
+	static digit_t newtonDiv (digit_t *quot, digit_t *rem, const digit_t *div, const digit_t *inv, size_t size, digit_t *scratch);
+	static size_t divScratch (size_t rem_size, size_t div_size);
+	static digit_t divAlgorithm (digit_t *quot, digit_t *rem, size_t rem_size, const digit_t *div, size_t div_size, digit_t *scratch);
+	static void divExactDigits (digit_t *quot, digit_t *rem, size_t size, const digit_t *div, size_t div_size, digit_t inv, digit_t *scratch);
+	static size_t divExactScratch (size_t size);
+	static void calculateDivMod (const hugeint &lhs, const hugeint &rhs, hugeint *quot, hugeint *rem, round_t mode = round_trunc);
+	static hugeint calculateDivExact (const hugeint &lhs, const hugeint &rhs);
 	static hugeint calculateDiv (const hugeint &lhs, const hugeint &rhs);
 	static hugeint calculateMod (const hugeint &lhs, const hugeint &rhs);
+	static hugeint calculateDiv (const hugeint &lhs, scalar_t rhs);
+	static hugeint calculateDiv (scalar_t lhs, const hugeint &rhs);
+	static hugeint calculateMod (const hugeint &lhs, scalar_t rhs);
+	static hugeint calculateMod (scalar_t lhs, const hugeint &rhs);
 
 	void setRamdon (size_t size, bool rand_sign); // Do not change
 
+	// Cofactors of a run of Euclid steps, with the numbers at the start being (u00 * a + u01 * b, u10 * a + u11 * b) in
+	// terms of the ones at the end. The determinant is 1
+	struct lehmer_t {
+		digit_t u00, u01, u10, u11;
+	};
+	// Cofactors of Euclid steps with hugeint entries, defined in hugeint_math.cpp
+	struct gcd_matrix_t;
+	static bool lehmerMatrix (lehmer_t &mat, double_t a, double_t b);
+	static double_t leadingBits (const digit_t *num, size_t size, size_t shift);
+	static void gcdStep (hugeint &a, hugeint &b, hugeint &temp, gcd_matrix_t *mat);
+	static void halfGcd (hugeint &a, hugeint &b, gcd_matrix_t &mat);
+	static void halfGcdApply (hugeint &a, hugeint &b, size_t shift, const hugeint &a_high, const hugeint &b_high, gcd_matrix_t &mat);
+	// Extended gcd of lhs and rhs of size digits on raw spans, for numbers below half_gcd_threshold digits. gcd gets
+	// their gcd and cof the magnitude of the cofactor of rhs, gcd = s * lhs + cof * rhs for some s, and the function
+	// returns true if that cofactor is negative
+	static bool lehmerGcdext (digit_t *gcd, digit_t *cof, const digit_t *lhs, const digit_t *rhs, size_t size, digit_t *scratch);
+	static size_t gcdextScratch (size_t size);
+	// For a, b >= 0, leaves gcd = s * a + cof * b in a for some s
+	static void gcdCofactor (hugeint &a, hugeint b, hugeint &cof);
 	void calculateGcd (hugeint other);
+	void calculateLcm (const hugeint &other);
+	static hugeint calculateGcdext (const hugeint &lhs, const hugeint &rhs, hugeint &s, hugeint &t);
+	void calculateInvertMod (const hugeint &modulo);
 
 	void calculatePow (exp_t exponent);
-	void calculatePow (exp_t exponent, const hugeint &to_mod);
+	void calculatePow (const hugeint &exponent, const hugeint &to_mod);
+	// Bits of the sliding window for an exponent of the given bit length
+	static size_t powWindow (size_t exp_bits);
+	// res = product of bases[i] ^ exponents[i] for count bases of ctx.size digits each, stored one after the other in
+	// the form of a reduction context, and exponents >= 0. res can be the same as the first base
+	template <typename context_t>
+	static void powDigits (const context_t &ctx, digit_t *res, const digit_t *bases, const hugeint *exponents, size_t count, digit_t *scratch);
+	// base ^ exponent % |modulus| with the sign rule of powMod, exponent >= 0
+	template <typename context_t>
+	static hugeint calculatePow (const context_t &ctx, const hugeint &base, const hugeint &exponent, digit_t *scratch);
+	template <typename context_t>
+	static hugeint calculateMultiPow (const context_t &ctx, const std::vector <hugeint> &bases, const std::vector <hugeint> &exponents);
+
+	static hugeint rootRem (const hugeint &num, root_t degree, hugeint &rem);
+	static hugeint sqrtRem (const hugeint &num, hugeint &rem);
+	// Whether num >= 0 is a square, and whether odd num > 0, with residue res modulo 2 ^ 64 - 1 and base 2 logarithm
+	// log, is a power of odd prime degree
+	static bool perfectSquare (const hugeint &num);
+	static bool oddPerfectPower (const hugeint &num, root_t degree, uint64_t res, double log);
+	// Residues of num > 0 modulo the odd trial division primes, one remainder by a digit for each group of them
+	static void trialResidues (const hugeint &num, std::vector <uint32_t> &res);
+	// Baillie-PSW test for odd num > 2 without small factors, on the reduction context powMod would pick for it
+	template <typename context_t>
+	static bool bpswTest (const context_t &ctx);
+	static bool bpswTest (const hugeint &num);
+	void calculateNextPrime ();
+	void calculateNthRoot (root_t degree, hugeint *rem = nullptr);
 
-	void calculateNthRoot (root_t degree);
+public:
+	// Digit counts of the smaller factor from which multiplication and squaring switch from the simple algorithm to Karatsuba
+	static size_t karatsuba_threshold;
+	static size_t karatsuba_square_threshold;
+	// Digit counts of the smaller factor from which multiplication switches to Toom-Cook 3 and 4 way
+	static size_t toom3_threshold;
+	static size_t toom4_threshold;
+#ifdef DIGIT_64
+	// Digit count of the smaller factor from which multiplication uses the number theoretic transform
+	static size_t ntt_threshold;
+#endif
+	// Digit count of the divisor from which division switches from schoolbook to Burnikel-Ziegler
+	static size_t burnikel_ziegler_threshold;
+	// Digit count of the divisor from which division multiplies by its reciprocal, found with Newton's method, when the
+	// quotient is at least 4 times as long as the divisor
+	static size_t newton_threshold;
+	// Digit count from which gcd reduces the numbers with the recursive half gcd instead of Lehmer's algorithm
+	static size_t half_gcd_threshold;
+	// Digit count from which the square root is found with Zimmermann's recursive Karatsuba square root instead of
+	// Newton's method
+	static size_t sqrt_threshold;
+	// Number of threads multiplication may use, 1 keeps everything on the calling thread. Products whose factors are
+	// smaller than parallel_threshold digits always run serially. The result doesn't depend on either of them
+	static size_t thread_count;
+	static size_t parallel_threshold;
+	// Read and write the thresholds above as "name value" lines. A file is loaded at startup from the path in the
+	// HUGEINT_THRESHOLDS environment variable, or from hugeint_thresholds.txt, if it exists. Returns false if the file
+	// couldn't be opened or had lines that were not understood, every line that was understood is still applied
+	static bool loadThresholds (const std::string &path);
+	static bool saveThresholds (const std::string &path);
+
+	// Digit count of odd moduli from which powMod uses Barrett instead of Montgomery reduction
+	static size_t montgomery_threshold;
+
+	// Reduction contexts for a fixed modulus, residues modulo one and powers of a fixed base, defined below
+	class barrett;
+	class montgomery;
+	class modint;
+	class fixedbase;
 
 	// Comparison operators
-public:
 	COMPARE(&&, (bool)lhs && (bool)rhs)
 	COMPARE(||, (bool)lhs || (bool)rhs)
 
@@ -209,6 +398,13 @@ public:
 	COMPARE(<=, !rhs.compareSml(lhs))
 	COMPARE(>=, !lhs.compareSml(rhs))
 
+	COMPARE_SCALAR(==)
+	COMPARE_SCALAR(!=)
+	COMPARE_SCALAR(<)
+	COMPARE_SCALAR(>)
+	COMPARE_SCALAR(<=)
+	COMPARE_SCALAR(>=)
+
 	// Bit operators
 	friend hugeint operator~ (const hugeint &rhs) {
 		hugeint to_mod = rhs;
@@ -286,6 +482,11 @@ public:
 	ASSIGN(-=, lhs.calculateAdd(rhs, true))
 	OPERATION(-, calculateAdd(lhs, rhs, true))
 
+	ASSIGN_SCALAR(+=, lhs.calculateAdd(rhs, false))
+	OPERATION_SCALAR(+, calculateAdd(lhs, rhs, false))
+	ASSIGN_SCALAR(-=, lhs.calculateAdd(rhs, true))
+	OPERATION_SCALAR(-, calculateAdd(lhs, rhs, true))
+
 	// Multiply and division operators
 	ASSIGN(*=, lhs = calculateMult(lhs, rhs))
 	OPERATION(*, calculateMult(lhs, rhs))
@@ -294,6 +495,13 @@ public:
 	ASSIGN(%=, lhs = calculateMod(lhs, rhs))
 	OPERATION(%, calculateMod(lhs, rhs))
 
+	ASSIGN_SCALAR(*=, lhs.calculateMult(rhs))
+	OPERATION_SCALAR(*, calculateMult(lhs, rhs))
+	ASSIGN_SCALAR(/=, lhs = calculateDiv(lhs, rhs))
+	OPERATION_SCALAR(/, calculateDiv(lhs, rhs))
+	ASSIGN_SCALAR(%=, lhs = calculateMod(lhs, rhs))
+	OPERATION_SCALAR(%, calculateMod(lhs, rhs))
+
 	// Extra functions
 	hugeint pow (exp_t exponent) {
 		calculatePow(exponent);
@@ -304,13 +512,51 @@ public:
 		return base;
 	}
 	hugeint powMod (exp_t exponent, const hugeint &modulo) {
-		calculatePow(exponent, modulo);
+		calculatePow(hugeint(exponent), modulo);
 		return *this;
 	}
 	static hugeint powMod (hugeint base, exp_t exponent, const hugeint &modulo) {
+		base.calculatePow(hugeint(exponent), modulo);
+		return base;
+	}
+	// Exponents of any size, which can't be negative
+	hugeint powMod (const hugeint &exponent, const hugeint &modulo) {
+		calculatePow(exponent, modulo);
+		return *this;
+	}
+	static hugeint powMod (hugeint base, const hugeint &exponent, const hugeint &modulo) {
 		base.calculatePow(exponent, modulo);
 		return base;
 	}
+	// powMod of each base with the exponent at the same index, all of them sharing the precomputation of the modulus
+	static std::vector <hugeint> powMod (const std::vector <hugeint> &bases, const std::vector <hugeint> &exponents, const hugeint &modulo);
+	// Product of bases[i] ^ exponents[i] modulo |modulo|, in [0, |modulo|). The powers share their squarings
+	static hugeint multiPowMod (const std::vector <hugeint> &bases, const std::vector <hugeint> &exponents, const hugeint &modulo);
+
+	// Quotient and remainder of a single division, with quot * divisor + rem equal to the dividend. The remainder is 0
+	// or has the sign of the dividend for round_trunc, of the divisor for round_floor and the opposite one for round_ceil
+	hugeint divmod (const hugeint &divisor, hugeint &rem, round_t mode = round_trunc) {
+		calculateDivMod(*this, divisor, this, &rem, mode);
+		return *this;
+	}
+	static void divmod (const hugeint &lhs, const hugeint &rhs, hugeint &quot, hugeint &rem, round_t mode = round_trunc) {
+		calculateDivMod(lhs, rhs, &quot, &rem, mode);
+	}
+	// Quotient of a division known to be exact, faster than / but meaningless when divisor doesn't divide the number
+	hugeint divexact (const hugeint &divisor) {
+		*this = calculateDivExact(*this, divisor);
+		return *this;
+	}
+	static hugeint divexact (const hugeint &num, const hugeint &divisor) {
+		return calculateDivExact(num, divisor);
+	}
+	// Divides by divisor like / and returns the absolute value of the remainder, which has the sign of the dividend.
+	// Faster than / and % for divisors of one or two digits
+	uint64_t divmod (uint64_t divisor);
+	static hugeint divmod (hugeint num, uint64_t divisor, uint64_t &rem) {
+		rem = num.divmod(divisor);
+		return num;
+	}
 
 	hugeint abs () {
 		if (neg) {
@@ -344,14 +590,31 @@ public:
 	}
 
 	hugeint lcm (const hugeint &other) {
-		hugeint gcd = *this;
-		gcd.calculateGcd(other);
-		return *this / gcd * other;
+		calculateLcm(other);
+		return *this;
 	}
-	static hugeint lcm (const hugeint &num1, const hugeint &num2) {
-		hugeint gcd = num1;
-		gcd.calculateGcd(num2);
-		return num1 / gcd * num2;
+	static hugeint lcm (hugeint num1, const hugeint &num2) {
+		num1.calculateLcm(num2);
+		return num1;
+	}
+
+	// gcd along with cofactors s and t such that s * this + t * other = gcd. For nonzero numbers of different
+	// magnitudes they are the minimal ones, |s| <= |other| / (2 * gcd) and |t| <= |this| / (2 * gcd)
+	hugeint gcdext (const hugeint &other, hugeint &s, hugeint &t) {
+		*this = calculateGcdext(*this, other, s, t);
+		return *this;
+	}
+	static hugeint gcdext (const hugeint &num1, const hugeint &num2, hugeint &s, hugeint &t) {
+		return calculateGcdext(num1, num2, s, t);
+	}
+	// Inverse modulo |modulo|, in [0, |modulo|). Throws if the number and the modulus aren't coprime
+	hugeint invertMod (const hugeint &modulo) {
+		calculateInvertMod(modulo);
+		return *this;
+	}
+	static hugeint invertMod (hugeint num, const hugeint &modulo) {
+		num.calculateInvertMod(modulo);
+		return num;
 	}
 
 	hugeint sqrt () {
@@ -378,6 +641,176 @@ public:
 		num.calculateNthRoot(degree);
 		return num;
 	}
+	// Root along with the remainder, the number minus the root raised to degree
+	hugeint rootrem (root_t degree, hugeint &rem) {
+		calculateNthRoot(degree, &rem);
+		return *this;
+	}
+	static hugeint rootrem (hugeint num, root_t degree, hugeint &rem) {
+		num.calculateNthRoot(degree, &rem);
+		return num;
+	}
+	// Whether the number is a square, or an integer raised to a degree of at least 2. 0 and 1 are both, negative
+	// numbers can only be powers of odd degree
+	bool isPerfectSquare () const;
+	bool isPerfectPower () const;
+
+	// Whether the number is prime, by trial division and then the Baillie-PSW test, which has no known counterexample.
+	// Numbers below 2 are not prime
+	bool isProbablePrime () const;
+	// Smallest prime larger than the number
+	hugeint nextPrime () {
+		calculateNextPrime();
+		return *this;
+	}
+	static hugeint nextPrime (hugeint num) {
+		num.calculateNextPrime();
+		return num;
+	}
+};
+
+// Reductions by a fixed modulus with its reciprocal computed once (Barrett reduction), so each one costs two
+// multiplications instead of a division. Any nonzero modulus works, its sign is ignored and every result is in
+// [0, |modulus|)
+class hugeint::barrett {
+	friend class hugeint;
+	friend class fixedbase;
+
+	hugeint mod;
+	std::vector <digit_t> recip; // floor(B ^ (2 * size) / mod), where B is the digit base
+	size_t size;
+
+	// res = num % mod for num of 2 * size digits, res gets size digits
+	void reduceDigits (digit_t *res, const digit_t *num, digit_t *scratch) const;
+	// Conversions between numbers and reduced ones of size digits, the working form of every context
+	void formDigits (digit_t *res, const hugeint &num, digit_t *scratch) const;
+	hugeint valueDigits (const digit_t *num) const;
+	// Products of reduced numbers of size digits, res can be the same as the factors
+	void mulDigits (digit_t *res, const digit_t *lhs, const digit_t *rhs, digit_t *scratch) const;
+	void sqrDigits (digit_t *res, const digit_t *num, digit_t *scratch) const;
+	size_t scratchSize () const;
+
+public:
+	explicit barrett (const hugeint &modulus);
+
+	const hugeint &modulus () const {
+		return mod;
+	}
+	hugeint reduce (const hugeint &num) const;
+	hugeint mulmod (const hugeint &lhs, const hugeint &rhs) const;
+	hugeint sqrmod (const hugeint &num) const;
+};
+
+// Montgomery multiplication for a fixed odd modulus m of size digits. Numbers are kept in the form x * R % m, where
+// R = B ^ size, and a product of two of them is reduced by adding a multiple of m that clears its low size digits,
+// which needs no division at all
+class hugeint::montgomery {
+	friend class hugeint;
+	friend class modint;
+	friend class fixedbase;
+
+	hugeint mod;
+	std::vector <digit_t> one; // R % m, the form of 1
+	std::vector <digit_t> square; // R ^ 2 % m, turns numbers into the form
+	digit_t inv; // -1 / m % B
+	size_t size;
+
+	// res = num % m in [0, m) padded to size digits
+	void loadDigits (digit_t *res, const hugeint &num) const;
+	// res = num / R % m for num of 2 * size digits below m * R, num is destroyed
+	void redcDigits (digit_t *res, digit_t *num) const;
+	// Conversions between numbers and the form of size digits
+	void formDigits (digit_t *res, const hugeint &num, digit_t *scratch) const;
+	hugeint valueDigits (const digit_t *num) const;
+	void mulDigits (digit_t *res, const digit_t *lhs, const digit_t *rhs, digit_t *scratch) const;
+	void sqrDigits (digit_t *res, const digit_t *num, digit_t *scratch) const;
+	size_t scratchSize () const;
+
+public:
+	// Throws if the modulus is even, its sign is ignored
+	explicit montgomery (const hugeint &modulus);
+
+	const hugeint &modulus () const {
+		return mod;
+	}
+	// Conversions to and from the form, in [0, |modulus|)
+	hugeint toForm (const hugeint &num) const;
+	hugeint fromForm (const hugeint &num) const;
+	// Product of two numbers in the form, which is in the form too
+	hugeint mulmod (const hugeint &lhs, const hugeint &rhs) const;
+};
+
+// A residue modulo the modulus of a Montgomery context, kept in the form across operations. The context has to
+// outlive every residue made from it, and residues from different contexts can't be mixed
+class hugeint::modint {
+	friend class hugeint;
+
+	const montgomery *ctx;
+	std::vector <digit_t> val;
+
+	modint (const montgomery *ctx) : ctx(ctx), val(ctx->size) {}
+	void checkContext (const modint &other) const;
+
+public:
+	modint (const montgomery &ctx, const hugeint &num = hugeint());
+
+	const montgomery &context () const {
+		return *ctx;
+	}
+	// The residue as a number in [0, |modulus|)
+	hugeint value () const;
+
+	modint &operator+= (const modint &rhs);
+	modint &operator-= (const modint &rhs);
+	modint &operator*= (const modint &rhs);
+	modint operator- () const;
+	// Throws if the residue isn't coprime with the modulus
+	modint inverse () const;
+	friend modint operator+ (modint lhs, const modint &rhs) {
+		return lhs += rhs;
+	}
+	friend modint operator- (modint lhs, const modint &rhs) {
+		return lhs -= rhs;
+	}
+	friend modint operator* (modint lhs, const modint &rhs) {
+		return lhs *= rhs;
+	}
+	friend bool operator== (const modint &lhs, const modint &rhs) {
+		return lhs.ctx == rhs.ctx && lhs.val == rhs.val;
+	}
+	friend bool operator!= (const modint &lhs, const modint &rhs) {
+		return !(lhs == rhs);
+	}
+
+	modint pow (exp_t exponent) const;
+	// Exponents of any size, which can't be negative
+	modint pow (const hugeint &exponent) const;
+};
+
+// Powers of a fixed base modulo a fixed modulus by the comb method. The exponent bits are split into teeth rows of
+// spacing bits, and the table holds the products of base ^ (2 ^ (row * spacing)) over every subset of rows, so a power
+// costs spacing squarings and products. The table is built once in about the time of a single powMod
+class hugeint::fixedbase {
+	std::unique_ptr <montgomery> mont; // Used for odd moduli below montgomery_threshold digits
+	std::unique_ptr <barrett> bar; // Used for the others
+	std::vector <digit_t> table; // 2 ^ teeth entries of size digits in the form of the context, the first one unused
+	size_t teeth, spacing, size;
+
+	template <typename context_t>
+	void buildTable (const context_t &ctx, const hugeint &base);
+	template <typename context_t>
+	hugeint calculatePow (const context_t &ctx, const hugeint &exponent) const;
+
+public:
+	// Table for exponents of up to exp_bits bits, longer ones are still correct but don't use it. Throws if the
+	// modulus is 0, its sign is ignored
+	fixedbase (const hugeint &base, const hugeint &modulus, size_t exp_bits);
+
+	const hugeint &modulus () const {
+		return mont ? mont->modulus() : bar->modulus();
+	}
+	// base ^ exponent modulo the modulus, in [0, |modulus|). Throws if the exponent is negative
+	hugeint pow (const hugeint &exponent) const;
 };
 
 #undef NOT_HUGEINT_TEMP
@@ -386,6 +819,9 @@ public:
 #undef COMPARE
 #undef OPERATION
 #undef ASSIGN
+#undef COMPARE_SCALAR
+#undef OPERATION_SCALAR
+#undef ASSIGN_SCALAR
 
 std::ostream &operator<< (std::ostream &out, const hugeint &to_show);
 std::ostream &operator<< (std::ostream &out, hugeint &&to_show);
@@ -51,12 +51,24 @@ size_t hugeint::fromDec (const std::string::const_iterator &begin, const std::st
 
 	digits.clear();
 	neg = false;
+	// Decimal digits are gathered in chunks as big as a digit can hold, each chunk is one multiply and one add
+	digit_t chunk = 0, power = 1;
 	for (std::string::const_iterator pos = begin; pos != end; pos++) {
 		if (*pos == '\'' || *pos == ' ') {
 			continue;
 		}
-		*this = calculateMult(*this, (hugeint)10);
-		calculateAdd((hugeint)(*pos - '0'));
+		chunk = chunk * 10 + (*pos - '0');
+		power *= 10;
+		if (power > digit_max / 10) {
+			multiplyDigit(power);
+			addDigit(chunk);
+			chunk = 0;
+			power = 1;
+		}
+	}
+	if (power > 1) {
+		multiplyDigit(power);
+		addDigit(chunk);
 	}
 	return -1;
 }
@@ -231,43 +243,56 @@ std::string hugeint::toHex () const {
 	}
 	return ans;
 }
-std::string hugeint::toDec () const {
-	bool is_neg = neg;
-	const hugeint *calc = this;
-	if (neg) {
-		calc = new hugeint(-*this);
+void hugeint::writeDec (std::string &ans, hugeint &num, const std::vector <hugeint> &powers, size_t level, size_t width) {
+	// Appends the decimal digits of the positive num from the bottom, padded with zeros to width digits unless width is
+	// 0. powers[level] is 10 ^ (chunk_len * 2 ^ level), where chunk_len decimal digits fit in a digit
+	size_t chunk_len = 0;
+	for (digit_t power = powers[0].digits[0]; power > 1; power /= 10) {
+		chunk_len++;
+	}
+	while (level > 0 && num < powers[level]) {
+		level--;
+	}
+	size_t start = ans.size();
+	if (level == 0 || num.digits.size() < burnikel_ziegler_threshold) {
+		// Decimal digits come out in chunks as big as a digit can hold, one division by a digit per chunk
+		do {
+			digit_t chunk = num.divmod(powers[0].digits[0]);
+			for (size_t pos = 0; pos < chunk_len && (chunk || !num.digits.empty()); pos++) {
+				ans.push_back('0' + chunk % 10);
+				chunk /= 10;
+			}
+		} while (!num.digits.empty());
 	}
+	else {
+		// Splitting by a power of 10 about the size of the square root makes the conversion as fast as division
+		hugeint low;
+		num.divmod(powers[level], low);
+		writeDec(ans, low, powers, level - 1, chunk_len << level);
+		writeDec(ans, num, powers, level, 0);
+	}
+	while (ans.size() - start < width) {
+		ans.push_back('0');
+	}
+}
+std::string hugeint::toDec () const {
+	hugeint calc = abs(*this);
 	std::string ans;
 	ans.reserve(digits.size() * digit_len * 301 / 1000); // digit count multiplied by log10(2) to estimate final size
-	ans.push_back(0);
-	for (std::vector <digit_t>::const_reverse_iterator chunk = calc->digits.rbegin(); chunk != calc->digits.rend(); chunk++) {
-		for (digit_t pos = (digit_t)1 << (digit_len - 1); pos > 0; pos >>= 1) {
-			//Multiply by 2
-			for (char &val : ans) {
-				val <<= 1;
-			}
-			// Add 1
-			if (*chunk & pos) {
-				ans[0]++;
-			}
-			// Carry
-			for (std::string::iterator it = ans.begin(); it + 1 != ans.end(); it++) {
-				if (*it > 9) {
-					*it -= 10;
-					*(it + 1) += 1;
-				}
-			}
-			if (ans.back() > 9) {
-				ans.back() -= 10;
-				ans.push_back(1);
-			}
-		}
+	// The largest power of 10 that fits in a digit, squared while the square is at most half the size of the number
+	digit_t power = 10;
+	while (power <= digit_max / 10) {
+		power *= 10;
 	}
-	for (char &chr : ans) {
-		chr += '0';
+	std::vector <hugeint> powers(1, hugeint(scalar_t {power, false}));
+	while (powers.back().digits.size() * 2 <= calc.digits.size()) {
+		powers.push_back(calculateSquare(powers.back()));
 	}
-	if (is_neg) {
-		delete calc;
+	writeDec(ans, calc, powers, powers.size() - 1, 0);
+	if (ans.empty()) {
+		ans.push_back('0');
+	}
+	if (neg) {
 		ans.push_back('-');
 	}
 	for (std::size_t index = 0; index < ans.size() / 2; index++) {
@@ -483,6 +508,12 @@ hugeint::hugeint (const char *to_copy) {
 	std::string str = to_copy;
 	fromString(str.begin(), str.end());
 }
+hugeint::hugeint (scalar_t to_copy) {
+	neg = to_copy.neg;
+	if (to_copy.val != (neg ? digit_max : 0)) {
+		digits.push_back(to_copy.val);
+	}
+}
 
 hugeint &hugeint::operator= (hugeint &&to_copy) noexcept {
 	digits = std::move(to_copy.digits);
@@ -499,6 +530,7 @@ hugeint &hugeint::operator= (bool to_copy) {
 }
 hugeint &hugeint::operator= (int16_t to_copy) {
 	digits.clear();
+	neg = false;
 	if (to_copy < 0) {
 		digits.push_back(-to_copy);
 		negate();
@@ -518,6 +550,7 @@ hugeint &hugeint::operator= (uint16_t to_copy) {
 }
 hugeint &hugeint::operator= (int32_t to_copy) {
 	digits.clear();
+	neg = false;
 	if (to_copy < 0) {
 		digits.push_back(-to_copy);
 		negate();
@@ -538,6 +571,7 @@ hugeint &hugeint::operator= (uint32_t to_copy) {
 #ifdef DIGIT_32
 hugeint &hugeint::operator= (int64_t to_copy) {
 	digits.clear();
+	neg = false;
 	if (to_copy < 0) {
 		digits.push_back(-to_copy);
 		digits.push_back((-to_copy) >> digit_len);
@@ -562,6 +596,7 @@ hugeint &hugeint::operator= (uint64_t to_copy) {
 #ifdef DIGIT_64
 hugeint &hugeint::operator= (int64_t to_copy) {
 	digits.clear();
+	neg = false;
 	if (to_copy < 0) {
 		digits.push_back(-to_copy);
 		negate();
@@ -581,6 +616,7 @@ hugeint &hugeint::operator= (uint64_t to_copy) {
 }
 hugeint &hugeint::operator= (__int128 to_copy) {
 	digits.clear();
+	neg = false;
 	if (to_copy < 0) {
 		digits.push_back(-to_copy);
 		digits.push_back((-to_copy) >> digit_len);
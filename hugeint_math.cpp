@@ -1,35 +1,892 @@
 #include "hugeint.h"
 
 #include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <fstream>
 #include <random>
 #include <functional>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 
-void hugeint::clearZeros () {
-	while (!digits.empty() && digits.back() == (neg ? digit_max : 0)) {
-		digits.pop_back();
+#if defined(DIGIT_64) && defined(__x86_64__) && defined(__GNUC__) && !defined(NO_ASM)
+#define X86_KERNELS
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+size_t hugeint::karatsuba_threshold = 32;
+size_t hugeint::karatsuba_square_threshold = 48;
+size_t hugeint::toom3_threshold = 100;
+size_t hugeint::toom4_threshold = 300;
+#ifdef DIGIT_64
+size_t hugeint::ntt_threshold = 16000;
+#endif
+size_t hugeint::burnikel_ziegler_threshold = 40;
+size_t hugeint::newton_threshold = 1000;
+size_t hugeint::half_gcd_threshold = 200;
+size_t hugeint::sqrt_threshold = 50;
+size_t hugeint::montgomery_threshold = 300;
+size_t hugeint::thread_count = 1;
+size_t hugeint::parallel_threshold = 1000;
+
+namespace {
+// Every threshold that can be tuned, by the name used in the thresholds file
+struct threshold_t {
+	const char *name;
+	size_t *value;
+};
+const threshold_t thresholds[] = {
+		{ "karatsuba_threshold", &hugeint::karatsuba_threshold },
+		{ "karatsuba_square_threshold", &hugeint::karatsuba_square_threshold },
+		{ "toom3_threshold", &hugeint::toom3_threshold },
+		{ "toom4_threshold", &hugeint::toom4_threshold },
+#ifdef DIGIT_64
+		{ "ntt_threshold", &hugeint::ntt_threshold },
+#endif
+		{ "burnikel_ziegler_threshold", &hugeint::burnikel_ziegler_threshold },
+		{ "newton_threshold", &hugeint::newton_threshold },
+		{ "half_gcd_threshold", &hugeint::half_gcd_threshold },
+		{ "sqrt_threshold", &hugeint::sqrt_threshold },
+		{ "montgomery_threshold", &hugeint::montgomery_threshold },
+		{ "parallel_threshold", &hugeint::parallel_threshold },
+};
+
+// The compiled-in defaults above are replaced by the thresholds file found at startup, if there is one
+const bool thresholds_loaded = hugeint::loadThresholds(
+		std::getenv("HUGEINT_THRESHOLDS") ? std::getenv("HUGEINT_THRESHOLDS") : "hugeint_thresholds.txt");
+}
+
+bool hugeint::loadThresholds (const std::string &path) {
+	std::ifstream file(path);
+	if (!file) {
+		return false;
+	}
+	// Every line holds a name and a digit count, lines starting with # are comments
+	bool valid = true;
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		size_t split = line.find(' ');
+		const threshold_t *found = nullptr;
+		for (const threshold_t &threshold : thresholds) {
+			if (line.compare(0, split, threshold.name) == 0) {
+				found = &threshold;
+			}
+		}
+		char *end = nullptr;
+		const char *number = split == std::string::npos ? "" : line.c_str() + split + 1;
+		unsigned long long value = std::strtoull(number, &end, 10);
+		if (!found || end == number) {
+			valid = false;
+			continue;
+		}
+		*found->value = value;
+	}
+	return valid;
+}
+bool hugeint::saveThresholds (const std::string &path) {
+	std::ofstream file(path);
+	file << "# Thresholds in digits of " << digit_len << " bits, written by the tune program\n";
+	for (const threshold_t &threshold : thresholds) {
+		file << threshold.name << ' ' << *threshold.value << '\n';
+	}
+	return (bool)file;
+}
+
+namespace {
+// Work stealing thread pool used by the parallel multiplication: https://en.wikipedia.org/wiki/Work_stealing
+// Every worker owns a queue, it takes its newest task first and steals the oldest task of another queue when it runs
+// out. Queue 0 is shared by the threads outside the pool.
+class task_pool {
+public:
+	typedef std::function <void ()> task_t;
+
+	explicit task_pool (size_t thread_count) : queues(thread_count), queued(0), stop(false) {
+		for (size_t id = 1; id < thread_count; id++) {
+			workers.emplace_back(&task_pool::work, this, id);
+		}
+	}
+	~task_pool () {
+		{
+			std::lock_guard <std::mutex> guard(wake_lock);
+			stop = true;
+		}
+		wake.notify_all();
+		for (std::thread &worker : workers) {
+			worker.join();
+		}
+	}
+
+	size_t size () const {
+		return queues.size();
+	}
+	// Runs all tasks and returns when they are done, the calling thread works on them too
+	void run (std::vector <task_t> &tasks) {
+		std::atomic <size_t> pending(tasks.size() - 1);
+		size_t self = current_pool == this ? current_id : 0;
+		{
+			std::lock_guard <std::mutex> guard(queues[self].lock);
+			for (size_t index = tasks.size() - 1; index > 0; index--) {
+				queues[self].tasks.push_back(entry_t { &tasks[index], &pending });
+			}
+		}
+		{
+			std::lock_guard <std::mutex> guard(wake_lock);
+			queued += tasks.size() - 1;
+		}
+		wake.notify_all();
+		tasks[0]();
+		// Helping with other tasks while waiting also keeps nested parallel levels from blocking the pool
+		while (pending.load() > 0) {
+			if (!runOne(self)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// The pool is rebuilt when hugeint::thread_count changes. Tasks started from a worker stay in its pool
+	static task_pool &instance () {
+		if (current_pool) {
+			return *current_pool;
+		}
+		static std::mutex lock;
+		static std::unique_ptr <task_pool> pool;
+		std::lock_guard <std::mutex> guard(lock);
+		size_t thread_count = std::max(hugeint::thread_count, (size_t)1);
+		if (!pool || pool->size() != thread_count) {
+			pool.reset();
+			pool.reset(new task_pool(thread_count));
+		}
+		return *pool;
+	}
+
+private:
+	struct entry_t {
+		task_t *task;
+		std::atomic <size_t> *pending;
+	};
+	struct queue_t {
+		std::mutex lock;
+		std::deque <entry_t> tasks;
+	};
+
+	std::vector <std::thread> workers;
+	std::vector <queue_t> queues;
+	std::mutex wake_lock;
+	std::condition_variable wake;
+	size_t queued;
+	bool stop;
+
+	static thread_local task_pool *current_pool;
+	static thread_local size_t current_id;
+
+	bool take (size_t self, entry_t &entry) {
+		{
+			std::lock_guard <std::mutex> guard(queues[self].lock);
+			if (!queues[self].tasks.empty()) {
+				entry = queues[self].tasks.back();
+				queues[self].tasks.pop_back();
+				return true;
+			}
+		}
+		for (size_t step = 1; step < queues.size(); step++) {
+			queue_t &victim = queues[(self + step) % queues.size()];
+			std::lock_guard <std::mutex> guard(victim.lock);
+			if (!victim.tasks.empty()) {
+				entry = victim.tasks.front();
+				victim.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+	bool runOne (size_t self) {
+		entry_t entry;
+		if (!take(self, entry)) {
+			return false;
+		}
+		{
+			std::lock_guard <std::mutex> guard(wake_lock);
+			queued--;
+		}
+		(*entry.task)();
+		entry.pending->fetch_sub(1);
+		return true;
+	}
+	void work (size_t id) {
+		current_pool = this;
+		current_id = id;
+		while (true) {
+			if (runOne(id)) {
+				continue;
+			}
+			std::unique_lock <std::mutex> guard(wake_lock);
+			wake.wait(guard, [this] { return stop || queued > 0; });
+			if (stop) {
+				return;
+			}
+		}
+	}
+};
+thread_local task_pool *task_pool::current_pool = nullptr;
+thread_local size_t task_pool::current_id = 0;
+
+// Splits a level in tasks only if more than one thread is allowed and the level is big enough to be worth it
+bool runParallel (size_t size) {
+	return hugeint::thread_count > 1 && size >= hugeint::parallel_threshold;
+}
+void runTasks (std::vector <std::function <void ()>> &tasks) {
+	if (tasks.size() == 1) {
+		tasks[0]();
+	}
+	else if (!tasks.empty()) {
+		task_pool::instance().run(tasks);
+	}
+}
+}
+
+#ifdef X86_KERNELS
+namespace {
+// Hand written x86-64 kernels for the basecase loops. Additions use the adc / sbb carry chain directly, products use
+// mulx with two independent carry chains (adcx through CF, adox through OF) when the CPU has BMI2 and ADX.
+bool detectMulxAdx () {
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+		return false;
+	}
+	return (ebx & bit_BMI2) && (ebx & bit_ADX);
+}
+const bool has_mulx_adx = detectMulxAdx();
+
+// res = lhs + rhs on size > 0 digits, returns the carry
+uint64_t addN (uint64_t *res, const uint64_t *lhs, const uint64_t *rhs, size_t size) {
+	uint64_t carry, temp;
+	int64_t index = -(int64_t)size;
+	__asm__ (
+			"xor %k[carry], %k[carry]\n\t"
+			"1:\n\t"
+			"mov (%[lhs],%[index],8), %[temp]\n\t"
+			"adc (%[rhs],%[index],8), %[temp]\n\t"
+			"mov %[temp], (%[res],%[index],8)\n\t"
+			"inc %[index]\n\t" // inc leaves CF alone
+			"jnz 1b\n\t"
+			"setc %b[carry]\n\t"
+			: [carry] "=&r" (carry), [temp] "=&r" (temp), [index] "+r" (index)
+			: [res] "r" (res + size), [lhs] "r" (lhs + size), [rhs] "r" (rhs + size)
+			: "cc", "memory");
+	return carry;
+}
+// res = lhs - rhs on size > 0 digits, returns the borrow
+uint64_t subN (uint64_t *res, const uint64_t *lhs, const uint64_t *rhs, size_t size) {
+	uint64_t borrow, temp;
+	int64_t index = -(int64_t)size;
+	__asm__ (
+			"xor %k[borrow], %k[borrow]\n\t"
+			"1:\n\t"
+			"mov (%[lhs],%[index],8), %[temp]\n\t"
+			"sbb (%[rhs],%[index],8), %[temp]\n\t"
+			"mov %[temp], (%[res],%[index],8)\n\t"
+			"inc %[index]\n\t"
+			"jnz 1b\n\t"
+			"setc %b[borrow]\n\t"
+			: [borrow] "=&r" (borrow), [temp] "=&r" (temp), [index] "+r" (index)
+			: [res] "r" (res + size), [lhs] "r" (lhs + size), [rhs] "r" (rhs + size)
+			: "cc", "memory");
+	return borrow;
+}
+// res = lhs * rhs, returns the high digit. Unrolled 4 times, the first size % 4 digits are done in C++.
+// The loop counter sits in rcx so jrcxz can end the loop without touching the flags
+uint64_t mul1 (uint64_t *res, const uint64_t *lhs, size_t size, uint64_t rhs) {
+	size_t head = size & 3;
+	unsigned __int128 prod = 0;
+	for (size_t index = 0; index < head; index++) {
+		prod += (unsigned __int128)lhs[index] * rhs;
+		res[index] = (uint64_t)prod;
+		prod >>= 64;
+	}
+	uint64_t carry = (uint64_t)prod;
+	if (size == head) {
+		return carry;
+	}
+	uint64_t low0, high0, low1, high1;
+	int64_t index = -(int64_t)(size - head);
+	__asm__ (
+			"xor %k[low0], %k[low0]\n\t"
+			"1:\n\t"
+			"mulx (%[lhs],%[index],8), %[low0], %[high0]\n\t"
+			"adcx %[carry], %[low0]\n\t"
+			"mov %[low0], (%[res],%[index],8)\n\t"
+			"mulx 8(%[lhs],%[index],8), %[low1], %[high1]\n\t"
+			"adcx %[high0], %[low1]\n\t"
+			"mov %[low1], 8(%[res],%[index],8)\n\t"
+			"mulx 16(%[lhs],%[index],8), %[low0], %[high0]\n\t"
+			"adcx %[high1], %[low0]\n\t"
+			"mov %[low0], 16(%[res],%[index],8)\n\t"
+			"mulx 24(%[lhs],%[index],8), %[low1], %[carry]\n\t"
+			"adcx %[high0], %[low1]\n\t"
+			"mov %[low1], 24(%[res],%[index],8)\n\t"
+			"lea 4(%[index]), %[index]\n\t"
+			"jrcxz 2f\n\t"
+			"jmp 1b\n"
+			"2:\n\t"
+			"mov $0, %k[low0]\n\t"
+			"adcx %[low0], %[carry]\n\t"
+			: [carry] "+&r" (carry), [low0] "=&r" (low0), [high0] "=&r" (high0), [low1] "=&r" (low1),
+			  [high1] "=&r" (high1), [index] "+c" (index)
+			: [res] "r" (res + size), [lhs] "r" (lhs + size), "d" (rhs)
+			: "cc", "memory");
+	return carry;
+}
+// res += lhs * rhs, returns the high digit. The product chain goes through CF and the addition of res through OF
+uint64_t addMul1 (uint64_t *res, const uint64_t *lhs, size_t size, uint64_t rhs) {
+	size_t head = size & 3;
+	unsigned __int128 prod = 0;
+	for (size_t index = 0; index < head; index++) {
+		prod += (unsigned __int128)lhs[index] * rhs + res[index];
+		res[index] = (uint64_t)prod;
+		prod >>= 64;
+	}
+	uint64_t carry = (uint64_t)prod;
+	if (size == head) {
+		return carry;
+	}
+	uint64_t low0, high0, low1, high1;
+	int64_t index = -(int64_t)(size - head);
+	__asm__ (
+			"xor %k[low0], %k[low0]\n\t"
+			"1:\n\t"
+			"mulx (%[lhs],%[index],8), %[low0], %[high0]\n\t"
+			"adcx %[carry], %[low0]\n\t"
+			"adox (%[res],%[index],8), %[low0]\n\t"
+			"mov %[low0], (%[res],%[index],8)\n\t"
+			"mulx 8(%[lhs],%[index],8), %[low1], %[high1]\n\t"
+			"adcx %[high0], %[low1]\n\t"
+			"adox 8(%[res],%[index],8), %[low1]\n\t"
+			"mov %[low1], 8(%[res],%[index],8)\n\t"
+			"mulx 16(%[lhs],%[index],8), %[low0], %[high0]\n\t"
+			"adcx %[high1], %[low0]\n\t"
+			"adox 16(%[res],%[index],8), %[low0]\n\t"
+			"mov %[low0], 16(%[res],%[index],8)\n\t"
+			"mulx 24(%[lhs],%[index],8), %[low1], %[carry]\n\t"
+			"adcx %[high0], %[low1]\n\t"
+			"adox 24(%[res],%[index],8), %[low1]\n\t"
+			"mov %[low1], 24(%[res],%[index],8)\n\t"
+			"lea 4(%[index]), %[index]\n\t"
+			"jrcxz 2f\n\t"
+			"jmp 1b\n"
+			"2:\n\t"
+			"mov $0, %k[low0]\n\t"
+			"adcx %[low0], %[carry]\n\t"
+			"adox %[low0], %[carry]\n\t"
+			: [carry] "+&r" (carry), [low0] "=&r" (low0), [high0] "=&r" (high0), [low1] "=&r" (low1),
+			  [high1] "=&r" (high1), [index] "+c" (index)
+			: [res] "r" (res + size), [lhs] "r" (lhs + size), "d" (rhs)
+			: "cc", "memory");
+	return carry;
+}
+}
+#endif
+
+namespace {
+// floor(num / den), with subtractions for the small quotients that are the most common ones in Euclid's algorithm
+template <typename Type>
+Type smallQuotient (Type num, Type den) {
+	for (Type quot = 0; quot < 3; quot++) {
+		if (num < den) {
+			return quot;
+		}
+		num -= den;
+	}
+	return num / den + 3;
+}
+#ifdef DIGIT_32
+int countLeadingZeros (uint32_t val) {
+	return __builtin_clz(val);
+}
+#endif
+int countLeadingZeros (uint64_t val) {
+	return __builtin_clzll(val);
+}
+}
+
+namespace {
+// Bitwise operations done by the portable and the vectorized kernels
+enum bitwise_op {
+	op_and,
+	op_or,
+	op_xor,
+	op_not,
+};
+template <bitwise_op op, typename digit_t>
+digit_t bitwiseDigit (digit_t lhs, digit_t rhs) {
+	return op == op_and ? lhs & rhs : op == op_or ? lhs | rhs : op == op_xor ? lhs ^ rhs : ~lhs;
+}
+}
+
+#ifdef X86_KERNELS
+namespace {
+// Vectorized limb kernels, the widest instruction set the CPU supports is picked once at startup
+const bool has_avx512 = __builtin_cpu_supports("avx512f");
+const bool has_avx2 = __builtin_cpu_supports("avx2");
+
+template <bitwise_op op>
+__attribute__((target("avx2"))) void bitwiseAvx2 (uint64_t *res, const uint64_t *lhs, const uint64_t *rhs, size_t size) {
+	const __m256i ones = _mm256_set1_epi64x(-1);
+	size_t index = 0;
+	for (; index + 4 <= size; index += 4) {
+		__m256i val1 = _mm256_loadu_si256((const __m256i *)(lhs + index));
+		__m256i val2 = op == op_not ? ones : _mm256_loadu_si256((const __m256i *)(rhs + index));
+		__m256i ans = op == op_and ? _mm256_and_si256(val1, val2) :
+		              op == op_or ? _mm256_or_si256(val1, val2) : _mm256_xor_si256(val1, val2);
+		_mm256_storeu_si256((__m256i *)(res + index), ans);
+	}
+	for (; index < size; index++) {
+		res[index] = bitwiseDigit <op>(lhs[index], op == op_not ? lhs[index] : rhs[index]);
+	}
+}
+template <bitwise_op op>
+__attribute__((target("avx512f"))) void bitwiseAvx512 (uint64_t *res, const uint64_t *lhs, const uint64_t *rhs, size_t size) {
+	const __m512i ones = _mm512_set1_epi64(-1);
+	size_t index = 0;
+	for (; index + 8 <= size; index += 8) {
+		__m512i val1 = _mm512_loadu_si512(lhs + index);
+		__m512i val2 = op == op_not ? ones : _mm512_loadu_si512(rhs + index);
+		__m512i ans = op == op_and ? _mm512_and_si512(val1, val2) :
+		              op == op_or ? _mm512_or_si512(val1, val2) : _mm512_xor_si512(val1, val2);
+		_mm512_storeu_si512(res + index, ans);
+	}
+	// The last few digits use a masked load and store instead of a scalar loop
+	__mmask8 rest = (__mmask8)((1u << (size - index)) - 1);
+	__m512i val1 = _mm512_maskz_loadu_epi64(rest, lhs + index);
+	__m512i val2 = op == op_not ? ones : _mm512_maskz_loadu_epi64(rest, rhs + index);
+	__m512i ans = op == op_and ? _mm512_and_si512(val1, val2) :
+	              op == op_or ? _mm512_or_si512(val1, val2) : _mm512_xor_si512(val1, val2);
+	_mm512_mask_storeu_epi64(res + index, rest, ans);
+}
+// res[index] = src[index] << shift | src[index - 1] >> (64 - shift) for index from size - 1 down to 1.
+// Going down lets res be the same as src or above it
+__attribute__((target("avx2"))) void shiftFwdAvx2 (uint64_t *res, const uint64_t *src, size_t size, int shift) {
+	const __m128i left = _mm_cvtsi32_si128(shift), right = _mm_cvtsi32_si128(64 - shift);
+	size_t index = size;
+	for (; index >= 5; index -= 4) {
+		__m256i high = _mm256_loadu_si256((const __m256i *)(src + index - 4));
+		__m256i low = _mm256_loadu_si256((const __m256i *)(src + index - 5));
+		_mm256_storeu_si256((__m256i *)(res + index - 4), _mm256_or_si256(_mm256_sll_epi64(high, left), _mm256_srl_epi64(low, right)));
+	}
+	for (index--; index > 0; index--) {
+		res[index] = (src[index] << shift) | (src[index - 1] >> (64 - shift));
+	}
+}
+// The zero-masked shifts with every lane selected are the plain ones, without the undefined pass-through operand that
+// GCC reports as maybe uninitialized
+__attribute__((target("avx512f"))) void shiftFwdAvx512 (uint64_t *res, const uint64_t *src, size_t size, int shift) {
+	const __m512i left = _mm512_set1_epi64(shift), right = _mm512_set1_epi64(64 - shift);
+	size_t index = size;
+	for (; index >= 9; index -= 8) {
+		__m512i high = _mm512_loadu_si512(src + index - 8);
+		__m512i low = _mm512_loadu_si512(src + index - 9);
+		_mm512_storeu_si512(res + index - 8, _mm512_or_si512(_mm512_maskz_sllv_epi64(0xff, high, left), _mm512_maskz_srlv_epi64(0xff, low, right)));
+	}
+	for (index--; index > 0; index--) {
+		res[index] = (src[index] << shift) | (src[index - 1] >> (64 - shift));
+	}
+}
+// res[index] = src[index] >> shift | src[index + 1] << (64 - shift) for index from 0 up to size - 2.
+// Going up lets res be the same as src or below it
+__attribute__((target("avx2"))) void shiftBackAvx2 (uint64_t *res, const uint64_t *src, size_t size, int shift) {
+	const __m128i right = _mm_cvtsi32_si128(shift), left = _mm_cvtsi32_si128(64 - shift);
+	size_t index = 0;
+	for (; index + 5 <= size; index += 4) {
+		__m256i low = _mm256_loadu_si256((const __m256i *)(src + index));
+		__m256i high = _mm256_loadu_si256((const __m256i *)(src + index + 1));
+		_mm256_storeu_si256((__m256i *)(res + index), _mm256_or_si256(_mm256_srl_epi64(low, right), _mm256_sll_epi64(high, left)));
+	}
+	for (; index + 1 < size; index++) {
+		res[index] = (src[index] >> shift) | (src[index + 1] << (64 - shift));
+	}
+}
+__attribute__((target("avx512f"))) void shiftBackAvx512 (uint64_t *res, const uint64_t *src, size_t size, int shift) {
+	const __m512i right = _mm512_set1_epi64(shift), left = _mm512_set1_epi64(64 - shift);
+	size_t index = 0;
+	for (; index + 9 <= size; index += 8) {
+		__m512i low = _mm512_loadu_si512(src + index);
+		__m512i high = _mm512_loadu_si512(src + index + 1);
+		_mm512_storeu_si512(res + index, _mm512_or_si512(_mm512_maskz_srlv_epi64(0xff, low, right), _mm512_maskz_sllv_epi64(0xff, high, left)));
+	}
+	for (; index + 1 < size; index++) {
+		res[index] = (src[index] >> shift) | (src[index + 1] << (64 - shift));
+	}
+}
+
+// Number of digits from the start that are equal to value
+__attribute__((target("avx2"))) size_t countEqualAvx2 (const uint64_t *src, size_t size, uint64_t value) {
+	const __m256i fill = _mm256_set1_epi64x(value);
+	size_t index = 0;
+	while (index + 4 <= size &&
+	       _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(src + index)), fill))) == 0xf) {
+		index += 4;
+	}
+	while (index < size && src[index] == value) {
+		index++;
+	}
+	return index;
+}
+__attribute__((target("avx512f"))) size_t countEqualAvx512 (const uint64_t *src, size_t size, uint64_t value) {
+	const __m512i fill = _mm512_set1_epi64(value);
+	for (size_t index = 0; index < size; index += 8) {
+		__mmask8 valid = size - index >= 8 ? 0xff : (__mmask8)((1u << (size - index)) - 1);
+		__mmask8 diff = _mm512_mask_cmpneq_epu64_mask(valid, _mm512_maskz_loadu_epi64(valid, src + index), fill);
+		if (diff) {
+			return index + __builtin_ctz(diff);
+		}
+	}
+	return size;
+}
+// Number of digits left after removing the ones at the end that are equal to value
+__attribute__((target("avx2"))) size_t trimEqualAvx2 (const uint64_t *src, size_t size, uint64_t value) {
+	const __m256i fill = _mm256_set1_epi64x(value);
+	while (size >= 4 &&
+	       _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(src + size - 4)), fill))) == 0xf) {
+		size -= 4;
+	}
+	while (size && src[size - 1] == value) {
+		size--;
+	}
+	return size;
+}
+__attribute__((target("avx512f"))) size_t trimEqualAvx512 (const uint64_t *src, size_t size, uint64_t value) {
+	const __m512i fill = _mm512_set1_epi64(value);
+	while (size) {
+		size_t start = size >= 8 ? size - 8 : 0;
+		__mmask8 valid = (__mmask8)((1u << (size - start)) - 1);
+		__mmask8 diff = _mm512_mask_cmpneq_epu64_mask(valid, _mm512_maskz_loadu_epi64(valid, src + start), fill);
+		if (diff) {
+			return start + 32 - __builtin_clz(diff);
+		}
+		size = start;
+	}
+	return 0;
+}
+}
+#endif
+
+namespace {
+// Applies op digit by digit, rhs is not used by op_not
+template <bitwise_op op, typename digit_t>
+void bitwiseDigits (digit_t *res, const digit_t *lhs, const digit_t *rhs, size_t size) {
+#ifdef X86_KERNELS
+	if (has_avx512) {
+		bitwiseAvx512 <op>(res, lhs, rhs, size);
+		return;
+	}
+	if (has_avx2) {
+		bitwiseAvx2 <op>(res, lhs, rhs, size);
+		return;
+	}
+#endif
+	for (size_t index = 0; index < size; index++) {
+		res[index] = bitwiseDigit <op>(lhs[index], op == op_not ? lhs[index] : rhs[index]);
+	}
+}
+// Number of digits from the start that are equal to value, used to run over carries and borrows
+template <typename digit_t>
+size_t countEqual (const digit_t *src, size_t size, digit_t value) {
+#ifdef X86_KERNELS
+	if (has_avx512) {
+		return countEqualAvx512(src, size, value);
+	}
+	if (has_avx2) {
+		return countEqualAvx2(src, size, value);
+	}
+#endif
+	size_t index = 0;
+	while (index < size && src[index] == value) {
+		index++;
+	}
+	return index;
+}
+// Number of digits left after removing the ones at the end that are equal to value
+template <typename digit_t>
+size_t trimEqual (const digit_t *src, size_t size, digit_t value) {
+#ifdef X86_KERNELS
+	if (has_avx512) {
+		return trimEqualAvx512(src, size, value);
+	}
+	if (has_avx2) {
+		return trimEqualAvx2(src, size, value);
+	}
+#endif
+	while (size && src[size - 1] == value) {
+		size--;
+	}
+	return size;
+}
+}
+
+#ifdef DIGIT_64
+namespace {
+// Prime of the form c * 2^k + 1 used by the number theoretic transform.
+// Values are kept in Montgomery form: https://en.wikipedia.org/wiki/Montgomery_modular_multiplication
+struct ntt_prime {
+	uint64_t mod;
+	uint64_t inv; // mod^-1 mod 2^64
+	uint64_t r2; // 2^128 % mod
+	uint64_t gen; // primitive root
+
+	ntt_prime (uint64_t mod, uint64_t gen) : mod(mod), gen(gen) {
+		inv = mod;
+		for (int step = 0; step < 5; step++) {
+			inv *= 2 - mod * inv;
+		}
+		r2 = (uint64_t)(((unsigned __int128)-1 % mod + 1) % mod);
+	}
+
+	// Returns a * b / 2^64 % mod, works for any a * b < mod * 2^64
+	uint64_t mult (uint64_t a, uint64_t b) const {
+		unsigned __int128 prod = (unsigned __int128)a * b;
+		uint64_t fix = (uint64_t)prod * inv;
+		uint64_t high = prod >> 64;
+		uint64_t sub = ((unsigned __int128)fix * mod) >> 64;
+		return high >= sub ? high - sub : high - sub + mod;
+	}
+	uint64_t add (uint64_t a, uint64_t b) const {
+		a += b;
+		return a >= mod ? a - mod : a;
+	}
+	uint64_t sub (uint64_t a, uint64_t b) const {
+		return a >= b ? a - b : a - b + mod;
 	}
+	uint64_t toForm (uint64_t val) const {
+		return mult(val, r2);
+	}
+	uint64_t pow (uint64_t base, uint64_t exponent) const {
+		uint64_t ans = toForm(1);
+		while (exponent) {
+			if (exponent & 1) {
+				ans = mult(ans, base);
+			}
+			base = mult(base, base);
+			exponent >>= 1;
+		}
+		return ans;
+	}
+
+	// roots[len + j] = w^j, where w is a primitive (2 * len)-th root of unity
+	std::vector <uint64_t> makeRoots (size_t len, bool inverse) const {
+		std::vector <uint64_t> roots(len);
+		uint64_t base = toForm(gen);
+		for (size_t half = 1; half < len; half <<= 1) {
+			uint64_t exponent = (mod - 1) / (half << 1);
+			uint64_t step = pow(base, inverse ? mod - 1 - exponent : exponent);
+			roots[half] = toForm(1);
+			for (size_t index = half + 1; index < half << 1; index++) {
+				roots[index] = mult(roots[index - 1], step);
+			}
+		}
+		return roots;
+	}
+	// Decimation in frequency, the output is in bit reversed order.
+	// Large transforms split the butterflies of the first stage in tasks, after which both halves are independent
+	void forward (uint64_t *vals, size_t len, const std::vector <uint64_t> &roots) const {
+		if (len > 1 && runParallel(len)) {
+			size_t half = len >> 1;
+			std::vector <std::function <void ()>> tasks;
+			size_t step = (half + hugeint::thread_count - 1) / hugeint::thread_count;
+			for (size_t start = 0; start < half; start += step) {
+				size_t end = std::min(start + step, half);
+				tasks.push_back([this, vals, half, start, end, &roots] {
+					for (size_t index = start; index < end; index++) {
+						uint64_t val1 = vals[index];
+						uint64_t val2 = vals[index + half];
+						vals[index] = add(val1, val2);
+						vals[index + half] = mult(sub(val1, val2), roots[half + index]);
+					}
+				});
+			}
+			runTasks(tasks);
+			tasks.clear();
+			tasks.push_back([this, vals, half, &roots] { forward(vals, half, roots); });
+			tasks.push_back([this, vals, half, &roots] { forward(vals + half, half, roots); });
+			runTasks(tasks);
+			return;
+		}
+		for (size_t half = len >> 1; half > 0; half >>= 1) {
+			for (size_t block = 0; block < len; block += half << 1) {
+				for (size_t index = 0; index < half; index++) {
+					uint64_t val1 = vals[block + index];
+					uint64_t val2 = vals[block + index + half];
+					vals[block + index] = add(val1, val2);
+					vals[block + index + half] = mult(sub(val1, val2), roots[half + index]);
+				}
+			}
+		}
+	}
+	// Decimation in time, the input is in bit reversed order. Large transforms do both halves as separate tasks, then
+	// split the butterflies of the last stage in tasks
+	void backward (uint64_t *vals, size_t len, const std::vector <uint64_t> &roots) const {
+		if (len > 1 && runParallel(len)) {
+			size_t half = len >> 1;
+			std::vector <std::function <void ()>> tasks;
+			tasks.push_back([this, vals, half, &roots] { backward(vals, half, roots); });
+			tasks.push_back([this, vals, half, &roots] { backward(vals + half, half, roots); });
+			runTasks(tasks);
+			tasks.clear();
+			size_t step = (half + hugeint::thread_count - 1) / hugeint::thread_count;
+			for (size_t start = 0; start < half; start += step) {
+				size_t end = std::min(start + step, half);
+				tasks.push_back([this, vals, half, start, end, &roots] {
+					for (size_t index = start; index < end; index++) {
+						uint64_t val1 = vals[index];
+						uint64_t val2 = mult(vals[index + half], roots[half + index]);
+						vals[index] = add(val1, val2);
+						vals[index + half] = sub(val1, val2);
+					}
+				});
+			}
+			runTasks(tasks);
+			return;
+		}
+		for (size_t half = 1; half < len; half <<= 1) {
+			for (size_t block = 0; block < len; block += half << 1) {
+				for (size_t index = 0; index < half; index++) {
+					uint64_t val1 = vals[block + index];
+					uint64_t val2 = mult(vals[block + index + half], roots[half + index]);
+					vals[block + index] = add(val1, val2);
+					vals[block + index + half] = sub(val1, val2);
+				}
+			}
+		}
+	}
+};
+
+// The product of the primes is above 2^183, so convolutions of up to 2^55 64 bit digits are exact
+const ntt_prime ntt_primes[3] = {
+		ntt_prime(4179340454199820289ull, 3), // 29 * 2^57 + 1
+		ntt_prime(2485986994308513793ull, 5), // 69 * 2^55 + 1
+		ntt_prime(1945555039024054273ull, 5), // 27 * 2^56 + 1
+};
+}
+#endif
+
+void hugeint::clearZeros () {
+	digits.resize(trimEqual(digits.data(), digits.size(), neg ? digit_max : (digit_t)0));
 }
 void hugeint::resize (size_t new_size) {
 	digits.resize(new_size, neg ? digit_max : 0);
 }
 void hugeint::invert () {
 	neg = !neg;
-	for (digit_t &word : digits) {
-		word = ~word;
+	bitwiseDigits <op_not>(digits.data(), digits.data(), (const digit_t *)nullptr, digits.size());
+}
+void hugeint::addDigit (digit_t val) {
+	if (digits.empty()) {
+		resize(1);
+	}
+	digits[0] += val;
+	if (digits[0] < val) {
+		// The carry runs over the digits equal to digit_max, past the end it cancels the sign or adds a digit
+		size_t carry = 1 + countEqual(digits.data() + 1, digits.size() - 1, digit_max);
+		std::fill(digits.begin() + 1, digits.begin() + carry, 0);
+		if (carry < digits.size()) {
+			digits[carry]++;
+		}
+		else if (neg) {
+			neg = false;
+		}
+		else {
+			digits.push_back(1);
+		}
+	}
+	clearZeros();
+}
+void hugeint::subtractDigit (digit_t val) {
+	if (digits.empty()) {
+		resize(1);
+	}
+	digit_t old = digits[0];
+	digits[0] -= val;
+	if (old < val) {
+		size_t borrow = 1 + countEqual(digits.data() + 1, digits.size() - 1, (digit_t)0);
+		std::fill(digits.begin() + 1, digits.begin() + borrow, (digit_t)digit_max);
+		if (borrow < digits.size()) {
+			digits[borrow]--;
+		}
+		else if (!neg) {
+			neg = true;
+		}
+		else {
+			digits.push_back(digit_max - 1);
+		}
+	}
+	clearZeros();
+}
+void hugeint::multiplyDigit (digit_t val) {
+	if (val == 0) {
+		digits.clear();
+		neg = false;
+		return;
 	}
+	// A negative number is its digits minus val << (size * digit_len), so the top digit gets val subtracted
+	digit_t carry = multDigit(digits.data(), digits.data(), digits.size(), val);
+	digits.push_back(neg ? carry - val : carry);
+	clearZeros();
+}
+hugeint::digit_t hugeint::divideDigit (digit_t divisor) {
+	// Only works on positive numbers, returns the remainder
+	digit_t rem = divDigit(digits.data(), digits.data(), digits.size(), divisor);
+	clearZeros();
+	return rem;
 }
 
 size_t hugeint::size () const {
 	size_t size = digits.size() * digit_len;
 	if (!digits.empty()) {
+		size -= countLeadingZeros(neg ? (digit_t)~digits.back() : digits.back());
+	}
+	return size;
+}
+uint64_t hugeint::divmod (uint64_t divisor) {
+	if (!divisor) {
+		throw (std::invalid_argument("Division by 0"));
+	}
+	bool sign = neg;
+	if (sign) {
+		negate();
+	}
+	uint64_t rem;
 #ifdef DIGIT_32
-		size -= __builtin_clz(neg ? ~digits.back() : digits.back());
+	if (divisor > digit_max) {
+		digit_t div[2] = { (digit_t)divisor, (digit_t)(divisor >> digit_len) }, rem_digits[2] = { 0, 0 };
+		if (digits.size() < 2) {
+			std::copy(digits.begin(), digits.end(), rem_digits);
+			digits.clear();
+		}
+		else {
+			divTwoDigits(digits.data(), digits.data(), digits.size(), div, rem_digits);
+			digits.pop_back();
+			clearZeros();
+		}
+		rem = (uint64_t)rem_digits[1] << digit_len | rem_digits[0];
+	}
+	else {
+		rem = divideDigit(divisor);
+	}
 #endif
 #ifdef DIGIT_64
-		size -= __builtin_clzll(neg ? ~digits.back() : digits.back());
+	rem = divideDigit(divisor);
 #endif
+	if (sign) {
+		negate();
 	}
-	return size;
+	return rem;
 }
 void hugeint::negate () {
 	invert();
@@ -67,11 +924,25 @@ bool hugeint::compareSml (const hugeint &to_comp) const {
 	}
 	for (size_t index = digits.size() - 1; index < digits.size(); index--) {
 		if (digits[index] != to_comp.digits[index]) {
-			return neg ^ (digits[index] < to_comp.digits[index]);
+			return digits[index] < to_comp.digits[index];
 		}
 	}
 	return false;
 }
+int hugeint::compareScalar (scalar_t to_comp) const {
+	// Same order as compareSml, the scalar has no digits if it equals its fill
+	if (neg != to_comp.neg) {
+		return neg ? -1 : 1;
+	}
+	size_t comp_size = to_comp.val != (to_comp.neg ? digit_max : 0);
+	if (digits.size() != comp_size) {
+		return neg ^ (digits.size() < comp_size) ? -1 : 1;
+	}
+	if (comp_size == 0 || digits[0] == to_comp.val) {
+		return 0;
+	}
+	return digits[0] < to_comp.val ? -1 : 1;
+}
 
 hugeint hugeint::calculateAnd (const hugeint &lhs, const hugeint &rhs) {
 	hugeint ret;
@@ -80,14 +951,11 @@ hugeint hugeint::calculateAnd (const hugeint &lhs, const hugeint &rhs) {
 	if (sml->digits.size() > big->digits.size()) {
 		std::swap(sml, big);
 	}
-	ret.digits.reserve(sml->neg ? sml->digits.size() : big->digits.size());
-	for (size_t i = 0; i < sml->digits.size(); i++) {
-		ret.digits.push_back(sml->digits[i] & big->digits[i]);
-	}
+	size_t common = sml->digits.size();
+	ret.digits.resize(sml->neg ? big->digits.size() : common);
+	bitwiseDigits <op_and>(ret.digits.data(), sml->digits.data(), big->digits.data(), common);
 	if (sml->neg) {
-		for (size_t i = sml->digits.size(); i < big->digits.size(); i++) {
-			ret.digits.push_back(big->digits[i]);
-		}
+		std::copy(big->digits.begin() + common, big->digits.end(), ret.digits.begin() + common);
 	}
 	ret.neg = sml->neg && big->neg;
 	ret.clearZeros();
@@ -98,13 +966,9 @@ void hugeint::calculateAnd (const hugeint &rhs) {
 		resize(rhs.digits.size());
 	}
 	size_t stop = std::min(digits.size(), rhs.digits.size());
-	for (size_t index = 0; index < stop; index++) {
-		digits[index] &= rhs.digits[index];
-	}
+	bitwiseDigits <op_and>(digits.data(), digits.data(), rhs.digits.data(), stop);
 	if (neg && digits.size() < rhs.digits.size()) {
-		for (size_t index = digits.size(); index < rhs.digits.size(); index++) {
-			digits.push_back(rhs.digits[index]);
-		}
+		digits.insert(digits.end(), rhs.digits.begin() + stop, rhs.digits.end());
 	}
 	neg = neg && rhs.neg;
 	clearZeros();
@@ -117,14 +981,11 @@ hugeint hugeint::calculateOr (const hugeint &lhs, const hugeint &rhs) {
 	if (sml->digits.size() > big->digits.size()) {
 		std::swap(sml, big);
 	}
-	ret.digits.reserve(sml->neg ? big->digits.size() : sml->digits.size());
-	for (size_t i = 0; i < sml->digits.size(); i++) {
-		ret.digits.push_back(sml->digits[i] | big->digits[i]);
-	}
+	size_t common = sml->digits.size();
+	ret.digits.resize(sml->neg ? common : big->digits.size());
+	bitwiseDigits <op_or>(ret.digits.data(), sml->digits.data(), big->digits.data(), common);
 	if (!sml->neg) {
-		for (size_t i = sml->digits.size(); i < big->digits.size(); i++) {
-			ret.digits.push_back(big->digits[i]);
-		}
+		std::copy(big->digits.begin() + common, big->digits.end(), ret.digits.begin() + common);
 	}
 	ret.neg = sml->neg || big->neg;
 	ret.clearZeros();
@@ -135,13 +996,9 @@ void hugeint::calculateOr (const hugeint &rhs) {
 		resize(rhs.digits.size());
 	}
 	size_t stop = std::min(digits.size(), rhs.digits.size());
-	for (size_t index = 0; index < stop; index++) {
-		digits[index] |= rhs.digits[index];
-	}
+	bitwiseDigits <op_or>(digits.data(), digits.data(), rhs.digits.data(), stop);
 	if (!neg && digits.size() < rhs.digits.size()) {
-		for (size_t index = digits.size(); index < rhs.digits.size(); index++) {
-			digits.push_back(rhs.digits[index]);
-		}
+		digits.insert(digits.end(), rhs.digits.begin() + stop, rhs.digits.end());
 	}
 	neg = neg || rhs.neg;
 	clearZeros();
@@ -154,21 +1011,16 @@ hugeint hugeint::calculateXor (const hugeint &lhs, const hugeint &rhs) {
 	if (sml->digits.size() > big->digits.size()) {
 		std::swap(sml, big);
 	}
-	ret.digits.reserve(big->digits.size());
-	for (size_t i = 0; i < sml->digits.size(); i++) {
-		ret.digits.push_back(sml->digits[i] ^ big->digits[i]);
-	}
+	size_t common = sml->digits.size();
+	ret.digits.resize(big->digits.size());
+	bitwiseDigits <op_xor>(ret.digits.data(), sml->digits.data(), big->digits.data(), common);
 	if (sml->neg) {
-		for (size_t i = sml->digits.size(); i < big->digits.size(); i++) {
-			ret.digits.push_back(~big->digits[i]);
-		}
+		bitwiseDigits <op_not>(ret.digits.data() + common, big->digits.data() + common, (const digit_t *)nullptr, big->digits.size() - common);
 	}
 	else {
-		for (size_t i = sml->digits.size(); i < big->digits.size(); i++) {
-			ret.digits.push_back(big->digits[i]);
-		}
+		std::copy(big->digits.begin() + common, big->digits.end(), ret.digits.begin() + common);
 	}
-	ret.neg = sml->neg || big->neg;
+	ret.neg = sml->neg ^ big->neg;
 	ret.clearZeros();
 	return ret;
 }
@@ -176,14 +1028,10 @@ void hugeint::calculateXor (const hugeint &rhs) {
 	if (digits.size() < rhs.digits.size()) {
 		resize(rhs.digits.size());
 	}
-	size_t stop = std::min(digits.size(), rhs.digits.size());
-	for (size_t index = 0; index < stop; index++) {
-		digits[index] ^= rhs.digits[index];
-	}
-	if (rhs.neg && digits.size() > rhs.digits.size()) {
-		for (size_t index = rhs.digits.size(); index < digits.size(); index++) {
-			digits[index] = ~digits[index];
-		}
+	size_t stop = rhs.digits.size();
+	bitwiseDigits <op_xor>(digits.data(), digits.data(), rhs.digits.data(), stop);
+	if (rhs.neg) {
+		bitwiseDigits <op_not>(digits.data() + stop, digits.data() + stop, (const digit_t *)nullptr, digits.size() - stop);
 	}
 	neg = neg ^ rhs.neg;
 	clearZeros();
@@ -191,75 +1039,44 @@ void hugeint::calculateXor (const hugeint &rhs) {
 
 void hugeint::shiftFwd (size_t val) {
 	size_t digit_move = val >> digit_log_len;
-	size_t bit_shift = val & (digit_len - 1);
-	resize(digits.size() + digit_move + 1);
+	int bit_shift = val & (digit_len - 1);
+	size_t size = digits.size();
+	resize(size + digit_move + 1);
 	if (bit_shift) {
-		for (size_t index = digits.size() - 1; index > digit_move; index--) {
-			digits[index] = (digits[index - digit_move] << bit_shift) | (digits[index - digit_move - 1] >> (digit_len - bit_shift));
-		}
+		shiftFwdDigits(digits.data() + digit_move, digits.data(), size + 1, bit_shift);
 	}
 	else {
-		for (size_t index = digits.size() - 1; index > digit_move; index--) {
-			digits[index] = digits[index - digit_move];
-		}
-	}
-	digits[digit_move] = digits[0] << bit_shift;
-	if (digit_move) {
-		std::memset(&digits.front(), 0x00, sizeof(digit_t) * digit_move);
+		std::copy_backward(digits.begin(), digits.begin() + size + 1, digits.end());
 	}
+	std::fill(digits.begin(), digits.begin() + digit_move, 0);
 	clearZeros();
 }
 void hugeint::shiftBack (size_t val) {
 	size_t digit_move = val >> digit_log_len;
-	size_t bit_shift = val & (digit_len - 1);
-	resize(std::max((size_t)1, digits.size() - digit_move));
+	int bit_shift = val & (digit_len - 1);
+	if (digit_move >= digits.size()) {
+		// Only the sign is left
+		digits.clear();
+		return;
+	}
+	size_t size = digits.size() - digit_move;
+	digit_t fill = neg ? digit_max : 0;
 	if (bit_shift) {
-		for (size_t index = 0; index < digits.size() - 1; index++) {
-			digits[index] = (digits[index + digit_move] >> bit_shift) | (digits[index + digit_move + 1] << (digit_len - bit_shift));
-		}
+		shiftBackDigits(digits.data(), digits.data() + digit_move, size, bit_shift);
+		digits[size - 1] |= fill << (digit_len - bit_shift);
 	}
 	else {
-		for (size_t index = 0; index < digits.size() - 1; index++) {
-			digits[index] = digits[index + digit_move];
-		}
+		std::copy(digits.begin() + digit_move, digits.end(), digits.begin());
 	}
-	digits.back() = digits[digits.size() - 1 + digit_move] >> bit_shift;
+	digits.resize(size);
 	clearZeros();
 }
 
 void hugeint::increment () {
-	if (neg && digits.empty()) {
-		neg = false;
-		return;
-	}
-	for (digit_t &word : digits) {
-		if (word == digit_max) {
-			word = 0;
-		}
-		else {
-			word++;
-			clearZeros();
-			return;
-		}
-	}
-	digits.push_back(1);
+	addDigit(1);
 }
 void hugeint::decrement () {
-	if (!neg && digits.empty()) {
-		neg = true;
-		return;
-	}
-	for (digit_t &word : digits) {
-		if (word == 0) {
-			word = digit_max;
-		}
-		else {
-			word--;
-			clearZeros();
-			return;
-		}
-	}
-	digits.push_back(digit_max - 1);
+	subtractDigit(1);
 }
 
 hugeint hugeint::calculateAdd (const hugeint &lhs, const hugeint &rhs, const bool diff) {
@@ -270,12 +1087,12 @@ hugeint hugeint::calculateAdd (const hugeint &lhs, const hugeint &rhs, const boo
 	hugeint ret;
 	ret.digits.reserve(big->digits.size());
 
-	digit_t carry = diff ? 1 : 0;
-	digit_t rhs_xor = diff ? digit_max : 0;
-	for (size_t index = 0; index < sml->digits.size(); index++) {
-		ret.digits.push_back(lhs.digits[index] + (rhs.digits[index] ^ rhs_xor) + carry);
-		carry = digit_t(ret.digits.back() < lhs.digits[index]) | (carry & digit_t(ret.digits.back() == lhs.digits[index]));
-	}
+	// A difference adds the complement of rhs plus 1, so its carry is the opposite of the borrow
+	size_t common = sml->digits.size();
+	ret.digits.resize(common);
+	digit_t carry = diff ?
+	                1 - subDigits(ret.digits.data(), lhs.digits.data(), common, rhs.digits.data(), common) :
+	                addDigits(ret.digits.data(), lhs.digits.data(), common, rhs.digits.data(), common);
 	digit_t sml_xor = sml->neg ^ (diff && lhs.digits.size() > rhs.digits.size()) ? digit_max : 0;
 	digit_t big_xor = diff && lhs.digits.size() <= rhs.digits.size() ? digit_max : 0;
 	for (size_t index = sml->digits.size(); index < big->digits.size(); index++) {
@@ -313,12 +1130,12 @@ void hugeint::calculateAdd (const hugeint &rhs, const bool diff) {
 		resize(rhs.digits.size());
 	}
 
-	digit_t carry = diff ? 1 : 0;
+	// A difference adds the complement of rhs plus 1, so its carry is the opposite of the borrow
+	size_t common = rhs.digits.size();
+	digit_t carry = diff ?
+	                1 - subDigits(digits.data(), digits.data(), common, rhs.digits.data(), common) :
+	                addDigits(digits.data(), digits.data(), common, rhs.digits.data(), common);
 	digit_t rhs_xor = diff ? digit_max : 0;
-	for (size_t index = 0; index < rhs.digits.size(); index++) {
-		digits[index] += (rhs.digits[index] ^ rhs_xor) + carry;
-		carry = digit_t(digits[index] < (rhs.digits[index] ^ rhs_xor)) | (carry & digit_t(digits[index] == (rhs.digits[index] ^ rhs_xor)));
-	}
 	rhs_xor ^= rhs.neg ? digit_max : 0;
 	for (size_t index = rhs.digits.size(); index < digits.size(); index++) {
 		if (rhs_xor + carry == 0) {
@@ -344,260 +1161,2963 @@ void hugeint::calculateAdd (const hugeint &rhs, const bool diff) {
 	}
 	clearZeros();
 }
-
-hugeint hugeint::simpleMult (std::vector <digit_t>::iterator begin1, std::vector <digit_t>::iterator end1,
-                             std::vector <digit_t>::iterator begin2, std::vector <digit_t>::iterator end2) {
-	size_t size1 = end1 - begin1;
-	size_t size2 = end2 - begin2;
-	hugeint ans;
-	double_t mult, over = 0, now = 0;
-	for (size_t i = 0; i < size1 + size2 - 1; i++) {
-		digit_t start = std::max(i + 1, size1) - size1;
-		std::vector <digit_t>::iterator it1 = begin1 + (i - start);
-		std::vector <digit_t>::iterator it2 = begin2 + start;
-		std::vector <digit_t>::iterator stop = begin2 + std::min(i + 1, size2);
-		while (it2 != stop) {
-			mult = (double_t)*it1 * *it2;
-			over += mult >> digit_len;
-			now += mult & digit_max;
-			it1--;
-			it2++;
-		}
-		ans.digits.push_back(now & digit_max);
-		over += now >> digit_len;
-		now = over & digit_max;
-		over >>= digit_len;
-	}
-	if (now) {
-		ans.digits.push_back(now);
+hugeint hugeint::calculateAdd (const hugeint &lhs, scalar_t rhs, const bool diff) {
+	hugeint ret = lhs;
+	ret.calculateAdd(rhs, diff);
+	return ret;
+}
+hugeint hugeint::calculateAdd (scalar_t lhs, const hugeint &rhs, const bool diff) {
+	// lhs - rhs is computed as -rhs + lhs
+	hugeint ret = rhs;
+	if (diff) {
+		ret.negate();
 	}
-	return ans;
+	ret.calculateAdd(lhs);
+	return ret;
 }
-hugeint hugeint::addKaratsuba (std::vector <digit_t>::iterator begin1, std::vector <digit_t>::iterator end1,
-                               std::vector <digit_t>::iterator begin2, std::vector <digit_t>::iterator end2) {
-	hugeint ret;
-	if (end1 - begin1 < end2 - begin2) {
-		std::swap(begin1, begin2);
-		std::swap(end1, end2);
+void hugeint::calculateAdd (scalar_t rhs, const bool diff) {
+	if (rhs.neg != diff) {
+		subtractDigit(rhs.abs());
 	}
-	ret.digits.reserve(end1 - begin1);
+	else {
+		addDigit(rhs.abs());
+	}
+}
+
+hugeint::digit_t hugeint::addDigits (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size) {
+	// lhs_size >= rhs_size, res can be the same as lhs or rhs
 	digit_t carry = 0;
-	while (begin2 != end2) {
-		ret.digits.push_back(*begin1 + *begin2 + carry);
-		carry = digit_t(ret.digits.back() < *begin1) | (carry & digit_t(ret.digits.back() == *begin1));
-		begin1++;
-		begin2++;
+	size_t index = 0;
+#ifdef X86_KERNELS
+	if (rhs_size) {
+		carry = addN(res, lhs, rhs, rhs_size);
+		index = rhs_size;
 	}
-	while (begin1 != end1) {
-		ret.digits.push_back(*begin1 + carry);
-		carry = digit_t(*begin1 == digit_max);
-		begin1++;
+#endif
+	for (; index < rhs_size; index++) {
+		digit_t sum = lhs[index] + carry;
+		carry = digit_t(sum < carry);
+		res[index] = sum + rhs[index];
+		carry |= digit_t(res[index] < sum);
 	}
 	if (carry) {
-		ret.digits.push_back(carry);
+		size_t stop = index + countEqual(lhs + index, lhs_size - index, digit_max);
+		std::fill(res + index, res + stop, 0);
+		index = stop;
+		if (index < lhs_size) {
+			res[index] = lhs[index] + 1;
+			index++;
+			carry = 0;
+		}
 	}
-	return ret;
+	if (res != lhs) {
+		std::copy(lhs + index, lhs + lhs_size, res + index);
+	}
+	return carry;
 }
-hugeint hugeint::karatsuba (std::vector <digit_t>::iterator begin1, std::vector <digit_t>::iterator end1,
-                            std::vector <digit_t>::iterator begin2, std::vector <digit_t>::iterator end2, size_t block_size) {
-	// Explanation for the karatsuba fast multiplication algorithm: https://en.wikipedia.org/wiki/Karatsuba_algorithm
-	block_size >>= 1;
-	std::vector <digit_t>::iterator cut1 = std::min(begin1 + block_size, end1);
-	std::vector <digit_t>::iterator cut2 = std::min(begin2 + block_size, end2);
-	std::vector <digit_t>::iterator last1 = cut1;
-	std::vector <digit_t>::iterator last2 = cut2;
-	while (begin1 != last1 && *(last1 - 1) == 0) {
-		last1--;
-	}
-	while (begin2 != last2 && *(last2 - 1) == 0) {
-		last2--;
-	}
-	hugeint high, mid, low;
-	high = multAlgorithm(cut1, end1, cut2, end2, block_size);
-	low = multAlgorithm(begin1, last1, begin2, last2, block_size);
-	hugeint add1 = addKaratsuba(begin1, last1, cut1, end1);
-	hugeint add2 = addKaratsuba(begin2, last2, cut2, end2);
-	if (add1.digits.size() > block_size) {
-		mid += add2 << (block_size << digit_log_len);
-		add1.digits.pop_back();
-	}
-	if (add2.digits.size() > block_size) {
-		mid += add1 << (block_size << digit_log_len);
-		add2.digits.pop_back();
-	}
-	mid += multAlgorithm(add1.digits.begin(), add1.digits.end(),
-	                     add2.digits.begin(), add2.digits.end(), block_size);
-
-	mid -= high;
-	mid -= low;
-	high <<= block_size << digit_log_len;
-	high += mid;
-	high <<= block_size << digit_log_len;
-	high += low;
-	return high;
-}
-hugeint hugeint::multAlgorithm (std::vector <digit_t>::iterator begin1, std::vector <digit_t>::iterator end1,
-                                std::vector <digit_t>::iterator begin2, std::vector <digit_t>::iterator end2, size_t block_size) {
-	size_t size1 = end1 - begin1;
-	size_t size2 = end2 - begin2;
-	if (size1 <= 0 || size2 <= 0) {
+hugeint::digit_t hugeint::subDigits (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size) {
+	// lhs_size >= rhs_size, res can be the same as lhs or rhs
+	digit_t borrow = 0;
+	size_t index = 0;
+#ifdef X86_KERNELS
+	if (rhs_size) {
+		borrow = subN(res, lhs, rhs, rhs_size);
+		index = rhs_size;
+	}
+#endif
+	for (; index < rhs_size; index++) {
+		digit_t diff = lhs[index] - rhs[index];
+		digit_t next = digit_t(lhs[index] < rhs[index]);
+		res[index] = diff - borrow;
+		borrow = next | digit_t(diff < borrow);
+	}
+	if (borrow) {
+		size_t stop = index + countEqual(lhs + index, lhs_size - index, (digit_t)0);
+		std::fill(res + index, res + stop, (digit_t)digit_max);
+		index = stop;
+		if (index < lhs_size) {
+			res[index] = lhs[index] - 1;
+			index++;
+			borrow = 0;
+		}
+	}
+	if (res != lhs) {
+		std::copy(lhs + index, lhs + lhs_size, res + index);
+	}
+	return borrow;
+}
+bool hugeint::lessDigits (const digit_t *lhs, const digit_t *rhs, size_t size) {
+	for (size_t index = size - 1; index < size; index--) {
+		if (lhs[index] != rhs[index]) {
+			return lhs[index] < rhs[index];
+		}
+	}
+	return false;
+}
+bool hugeint::subAbsDigits (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size) {
+	// Writes |lhs - rhs| on lhs_size digits and returns true if lhs < rhs
+	bool smaller = true;
+	for (size_t index = lhs_size - 1; index < lhs_size; index--) {
+		digit_t comp = index < rhs_size ? rhs[index] : 0;
+		if (lhs[index] != comp) {
+			smaller = lhs[index] < comp;
+			break;
+		}
+		if (index == 0) {
+			smaller = false;
+		}
+	}
+	if (smaller) {
+		subDigits(res, rhs, rhs_size, lhs, rhs_size);
+		std::fill(res + rhs_size, res + lhs_size, 0);
+	}
+	else {
+		subDigits(res, lhs, lhs_size, rhs, rhs_size);
+	}
+	return smaller;
+}
+hugeint::digit_t hugeint::multDigit (digit_t *res, const digit_t *lhs, size_t size, digit_t rhs) {
+	// Returns the carry, res can be the same as lhs
+#ifdef X86_KERNELS
+	if (has_mulx_adx) {
+		return mul1(res, lhs, size, rhs);
+	}
+#endif
+	double_t carry = 0;
+	for (size_t index = 0; index < size; index++) {
+		carry += (double_t)lhs[index] * rhs;
+		res[index] = carry & digit_max;
+		carry >>= digit_len;
+	}
+	return carry;
+}
+hugeint::digit_t hugeint::addMultDigit (digit_t *res, const digit_t *lhs, size_t size, digit_t rhs) {
+#ifdef X86_KERNELS
+	if (has_mulx_adx) {
+		return addMul1(res, lhs, size, rhs);
+	}
+#endif
+	double_t carry = 0;
+	for (size_t index = 0; index < size; index++) {
+		carry += (double_t)lhs[index] * rhs + res[index];
+		res[index] = carry & digit_max;
+		carry >>= digit_len;
+	}
+	return carry;
+}
+hugeint::digit_t hugeint::subMultDigit (digit_t *res, const digit_t *lhs, size_t size, digit_t rhs) {
+	double_t carry = 0;
+	for (size_t index = 0; index < size; index++) {
+		carry += (double_t)lhs[index] * rhs;
+		digit_t low = carry & digit_max;
+		carry >>= digit_len;
+		carry += res[index] < low;
+		res[index] -= low;
+	}
+	return carry;
+}
+hugeint::digit_t hugeint::invertDigit (digit_t div) {
+	// floor((B^2 - 1) / div) - B for a normalized div, where B is the digit base. The numerator is B^2 - 1 - B * div
+	return (((double_t)(digit_t)~div << digit_len) | digit_max) / div;
+}
+hugeint::digit_t hugeint::invertTwoDigits (digit_t div1, digit_t div0) {
+	// floor((B^3 - 1) / div) - B for the normalized two digit div1:div0, found by correcting the reciprocal of div1
+	digit_t inv = invertDigit(div1);
+	digit_t prod = div1 * inv + div0;
+	if (prod < div0) {
+		inv--;
+		if (prod >= div1) {
+			inv--;
+			prod -= div1;
+		}
+		prod -= div1;
+	}
+	double_t low = (double_t)div0 * inv;
+	prod += (digit_t)(low >> digit_len);
+	if (prod < (digit_t)(low >> digit_len)) {
+		inv--;
+		if (prod > div1 || (prod == div1 && (digit_t)low >= div0)) {
+			inv--;
+		}
+	}
+	return inv;
+}
+hugeint::digit_t hugeint::divStep (digit_t &rem, digit_t low, digit_t div, digit_t inv) {
+	// Divides rem:low by the normalized div with its reciprocal from invertDigit (Moller and Granlund). rem has to be
+	// below div and is replaced by the remainder
+	double_t est = (double_t)inv * rem + ((double_t)(rem + 1) << digit_len | low);
+	digit_t quot = est >> digit_len;
+	rem = low - quot * div;
+	if (rem > (digit_t)est) {
+		quot--;
+		rem += div;
+	}
+	if (rem >= div) {
+		quot++;
+		rem -= div;
+	}
+	return quot;
+}
+hugeint::digit_t hugeint::divStep (double_t &rem, digit_t low, double_t div, digit_t inv) {
+	// Same for three digits rem:low by the normalized two digit div, with the reciprocal from invertTwoDigits
+	digit_t rem1 = rem >> digit_len, div1 = div >> digit_len;
+	double_t est = (double_t)inv * rem1 + rem;
+	digit_t quot = est >> digit_len;
+	rem = ((double_t)(digit_t)((digit_t)rem - quot * div1) << digit_len | low) - div - (double_t)(digit_t)div * quot;
+	quot++;
+	if ((digit_t)(rem >> digit_len) >= (digit_t)est) {
+		quot--;
+		rem += div;
+	}
+	if (rem >= div) {
+		quot++;
+		rem -= div;
+	}
+	return quot;
+}
+hugeint::digit_t hugeint::divDigit (digit_t *res, const digit_t *lhs, size_t size, digit_t rhs) {
+	// Returns the remainder, res can be the same as lhs. The dividend is shifted as it is read so rhs is normalized, then
+	// every digit takes two multiplications by the reciprocal instead of a hardware division
+	int shift = countLeadingZeros(rhs);
+	digit_t div = rhs << shift, inv = invertDigit(div), rem = 0;
+	if (!size) {
+		return 0;
+	}
+	if (!shift) {
+		for (size_t index = size - 1; index < size; index--) {
+			res[index] = divStep(rem, lhs[index], div, inv);
+		}
+		return rem;
+	}
+	rem = lhs[size - 1] >> (digit_len - shift);
+	for (size_t index = size - 1; index > 0; index--) {
+		res[index] = divStep(rem, lhs[index] << shift | lhs[index - 1] >> (digit_len - shift), div, inv);
+	}
+	res[0] = divStep(rem, lhs[0] << shift, div, inv);
+	return rem >> shift;
+}
+hugeint::digit_t hugeint::modDigit (const digit_t *lhs, size_t size, digit_t rhs) {
+	// Same as divDigit without writing the quotient
+	int shift = countLeadingZeros(rhs);
+	digit_t div = rhs << shift, inv = invertDigit(div), rem = 0;
+	if (!size) {
 		return 0;
 	}
-	if (size1 == 1 && size2 == 1) {
-		return (hugeint)((double_t)*begin1 * *begin2);
+	if (!shift) {
+		for (size_t index = size - 1; index < size; index--) {
+			divStep(rem, lhs[index], div, inv);
+		}
+		return rem;
 	}
-	if (size1 * size1 < size2 || size2 * size2 < size1) {
-		return simpleMult(begin1, end1, begin2, end2);
+	rem = lhs[size - 1] >> (digit_len - shift);
+	for (size_t index = size - 1; index > 0; index--) {
+		divStep(rem, lhs[index] << shift | lhs[index - 1] >> (digit_len - shift), div, inv);
 	}
-	while (block_size >= std::max(size1, size2) << 1) {
-		block_size >>= 1;
+	divStep(rem, lhs[0] << shift, div, inv);
+	return rem >> shift;
+}
+void hugeint::divTwoDigits (digit_t *res, const digit_t *lhs, size_t size, const digit_t *rhs, digit_t *rem) {
+	// Same as divDigit for a divisor of two digits whose top one isn't 0, with size at least 2. res gets size - 1
+	// digits and can be the same as lhs, rem gets 2 digits
+	int shift = countLeadingZeros(rhs[1]);
+	double_t div = ((double_t)rhs[1] << digit_len | rhs[0]) << shift;
+	digit_t inv = invertTwoDigits(div >> digit_len, div);
+	// The top two digits of the shifted dividend start the remainder, they are below div
+	double_t part = (double_t)lhs[size - 1] << digit_len | lhs[size - 2];
+	double_t cur = shift ? (part >> (digit_len - shift)) : (double_t)lhs[size - 1];
+	for (size_t index = size - 2; index < size; index--) {
+		digit_t low = lhs[index] << shift;
+		if (shift && index) {
+			low |= lhs[index - 1] >> (digit_len - shift);
+		}
+		res[index] = divStep(cur, low, div, inv);
 	}
-	return karatsuba(begin1, end1, begin2, end2, block_size);
+	cur >>= shift;
+	rem[0] = cur;
+	rem[1] = cur >> digit_len;
 }
-hugeint hugeint::calculateMult (const hugeint &lhs, const hugeint &rhs) {
-	hugeint lhs_copy = lhs;
-	hugeint rhs_copy = rhs;
-	lhs_copy.abs();
-	rhs_copy.abs();
-	hugeint ret = multAlgorithm(lhs_copy.digits.begin(), lhs_copy.digits.end(),
-	                            rhs_copy.digits.begin(), rhs_copy.digits.end(), (digit_t)1 << (digit_len - 1));
-	if (lhs.neg ^ rhs.neg) {
-		ret.negate();
+hugeint::digit_t hugeint::invertOdd (digit_t val) {
+	// Inverse of an odd val modulo B. (3 * val) xor 2 is right in the low 5 bits and each Newton step doubles them
+	digit_t inv = (val * 3) ^ 2;
+	for (int bits = 5; bits < digit_len; bits <<= 1) {
+		inv *= 2 - val * inv;
+	}
+	return inv;
+}
+void hugeint::divExactDigit (digit_t *res, const digit_t *lhs, size_t size, digit_t rhs) {
+	// res = lhs / rhs for an odd rhs that divides lhs, res can be the same as lhs. Working from the bottom every
+	// quotient digit is the current digit times the inverse of rhs, so there is no division at all
+	digit_t inv = invertOdd(rhs), borrow = 0;
+	for (size_t index = 0; index < size; index++) {
+		digit_t cur = lhs[index] - borrow;
+		borrow = cur > lhs[index];
+		cur *= inv;
+		res[index] = cur;
+		borrow += ((double_t)cur * rhs) >> digit_len;
+	}
+}
+hugeint::digit_t hugeint::shiftFwdDigits (digit_t *res, const digit_t *src, size_t size, int shift) {
+	// 0 < shift < digit_len, returns the bits shifted out. res can be the same as src
+	digit_t out = src[size - 1] >> (digit_len - shift);
+#ifdef X86_KERNELS
+	if (has_avx512) {
+		shiftFwdAvx512(res, src, size, shift);
+	}
+	else if (has_avx2) {
+		shiftFwdAvx2(res, src, size, shift);
+	}
+	else
+#endif
+	for (size_t index = size - 1; index > 0; index--) {
+		res[index] = (src[index] << shift) | (src[index - 1] >> (digit_len - shift));
+	}
+	res[0] = src[0] << shift;
+	return out;
+}
+void hugeint::shiftBackDigits (digit_t *res, const digit_t *src, size_t size, int shift) {
+	// 0 < shift < digit_len, res can be the same as src
+#ifdef X86_KERNELS
+	if (has_avx512) {
+		shiftBackAvx512(res, src, size, shift);
+	}
+	else if (has_avx2) {
+		shiftBackAvx2(res, src, size, shift);
+	}
+	else
+#endif
+	for (size_t index = 0; index + 1 < size; index++) {
+		res[index] = (src[index] >> shift) | (src[index + 1] << (digit_len - shift));
+	}
+	res[size - 1] = src[size - 1] >> shift;
+}
+
+void hugeint::simpleMult (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size) {
+	res[lhs_size] = multDigit(res, lhs, lhs_size, rhs[0]);
+	for (size_t index = 1; index < rhs_size; index++) {
+		res[lhs_size + index] = addMultDigit(res + index, lhs, lhs_size, rhs[index]);
+	}
+}
+void hugeint::simpleSquare (digit_t *res, const digit_t *num, size_t size) {
+	// Products of different digits appear twice, so they are added once then doubled
+	res[0] = 0;
+	res[(size << 1) - 1] = 0;
+	if (size > 1) {
+		res[size] = multDigit(res + 1, num + 1, size - 1, num[0]);
+	}
+	for (size_t index = 1; index + 1 < size; index++) {
+		res[index + size] = addMultDigit(res + (index << 1) + 1, num + index + 1, size - index - 1, num[index]);
+	}
+	shiftFwdDigits(res, res, size << 1, 1);
+	digit_t carry = 0;
+	for (size_t index = 0; index < size; index++) {
+		double_t square = (double_t)num[index] * num[index];
+		double_t sum = (double_t)res[index << 1] + (square & digit_max) + carry;
+		res[index << 1] = sum & digit_max;
+		sum = (double_t)res[(index << 1) + 1] + (square >> digit_len) + (sum >> digit_len);
+		res[(index << 1) + 1] = sum & digit_max;
+		carry = sum >> digit_len;
 	}
-	return ret;
 }
+void hugeint::karatsuba (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size, digit_t *scratch) {
+	// Explanation for the karatsuba fast multiplication algorithm: https://en.wikipedia.org/wiki/Karatsuba_algorithm
+	size_t half = (lhs_size + 1) >> 1;
+	if (rhs_size <= half) {
+		// Only lhs is split: lhs_low * rhs + (lhs_high * rhs << half)
+		size_t high_size = lhs_size - half;
+		const product_t prods[2] = {
+				{ res, lhs, half, rhs, rhs_size },
+				{ scratch, lhs + half, high_size, rhs, rhs_size },
+		};
+		multProducts(prods, 2, scratch + high_size + rhs_size);
+		addDigits(res + half, scratch, high_size + rhs_size, res + half, rhs_size);
+		return;
+	}
 
-hugeint hugeint::simpleDiv (hugeint lhs, hugeint rhs, bool rem) {
-	size_t init_shift = digit_len - (rhs.size() & (digit_len - 1));
-	lhs <<= init_shift;
-	rhs <<= init_shift;
+	// mid = low + high - (lhs_low - lhs_high) * (rhs_low - rhs_high)
+	size_t high_size = lhs_size + rhs_size - (half << 1);
+	digit_t *diff1 = scratch;
+	digit_t *diff2 = scratch + half;
+	digit_t *mid = scratch + (half << 1);
+	digit_t *temp = scratch + (half << 2);
+	bool mid_neg = subAbsDigits(diff1, lhs, half, lhs + half, lhs_size - half);
+	mid_neg ^= subAbsDigits(diff2, rhs, half, rhs + half, rhs_size - half);
+	const product_t prods[3] = {
+			{ res, lhs, half, rhs, half },
+			{ res + (half << 1), lhs + half, lhs_size - half, rhs + half, rhs_size - half },
+			{ mid, diff1, half, diff2, half },
+	};
+	multProducts(prods, 3, temp);
+
+	temp[half << 1] = addDigits(temp, res, half << 1, res + (half << 1), high_size);
+	if (mid_neg) {
+		addDigits(temp, temp, (half << 1) + 1, mid, half << 1);
+	}
+	else {
+		subDigits(temp, temp, (half << 1) + 1, mid, half << 1);
+	}
+	size_t rest = lhs_size + rhs_size - half;
+	addDigits(res + half, res + half, rest, temp, std::min((half << 1) + 1, rest));
+}
+void hugeint::unbalancedMult (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size, digit_t *scratch) {
+	// lhs is cut in blocks of rhs_size digits, each block is multiplied with the balanced algorithms and added in place.
+	// Needs lhs_size >= rhs_size
+	if (runParallel(lhs_size)) {
+		// The products of every other block don't overlap, so the even blocks go straight to res and the odd ones to a
+		// second buffer that is added at the end
+		size_t block_count = (lhs_size + rhs_size - 1) / rhs_size;
+		std::vector <digit_t> odd_res(lhs_size);
+		std::vector <product_t> prods;
+		for (size_t index = 0; index < block_count; index++) {
+			size_t pos = index * rhs_size;
+			digit_t *dest = index & 1 ? odd_res.data() + pos - rhs_size : res + pos;
+			prods.push_back({ dest, lhs + pos, std::min(rhs_size, lhs_size - pos), rhs, rhs_size });
+		}
+		std::fill(res + block_count * rhs_size, res + lhs_size + rhs_size, 0);
+		multProducts(prods.data(), prods.size(), scratch);
+		size_t odd_size = block_count & 1 ? (block_count - 1) * rhs_size : lhs_size;
+		addDigits(res + rhs_size, res + rhs_size, lhs_size, odd_res.data(), odd_size);
+		return;
+	}
+	digit_t *prod = scratch;
+	digit_t *rest = scratch + (rhs_size << 1);
+	multAlgorithm(res, lhs, rhs_size, rhs, rhs_size, rest);
+	for (size_t pos = rhs_size; pos < lhs_size; pos += rhs_size) {
+		size_t block = std::min(rhs_size, lhs_size - pos);
+		multAlgorithm(prod, lhs + pos, block, rhs, rhs_size, rest);
+		// The low half overlaps the previous product, the high half goes to digits not written yet
+		std::copy(prod + rhs_size, prod + rhs_size + block, res + pos + rhs_size);
+		addDigits(res + pos, res + pos, rhs_size + block, prod, rhs_size);
+	}
+}
+void hugeint::karatsubaSquare (digit_t *res, const digit_t *num, size_t size, digit_t *scratch) {
+	// Same as karatsuba, the middle term is low + high - (num_low - num_high)^2
+	size_t half = (size + 1) >> 1;
+	digit_t *diff = scratch;
+	digit_t *mid = scratch + half;
+	digit_t *temp = scratch + half * 3;
+	subAbsDigits(diff, num, half, num + half, size - half);
+	const product_t prods[3] = {
+			{ res, num, half, num, half },
+			{ res + (half << 1), num + half, size - half, num + half, size - half },
+			{ mid, diff, half, diff, half },
+	};
+	multProducts(prods, 3, temp);
 
-	size_t len_dif = lhs.digits.size() - rhs.digits.size();
-	hugeint temp1, temp2, ans;
-	ans.digits.resize(len_dif);
+	temp[half << 1] = addDigits(temp, res, half << 1, res + (half << 1), (size - half) << 1);
+	subDigits(temp, temp, (half << 1) + 1, mid, half << 1);
+	size_t rest = (size << 1) - half;
+	addDigits(res + half, res + half, rest, temp, std::min((half << 1) + 1, rest));
+}
+void hugeint::toom3 (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size, digit_t *scratch) {
+	// Explanation for the Toom-Cook multiplication algorithm: https://en.wikipedia.org/wiki/Toom%E2%80%93Cook_multiplication
+	// Both numbers are split in 3 parts and the product is evaluated in the points 0, 1, -1, 2 and infinity.
+	// Needs rhs_size > 2 * part, so that no part is empty
+	bool square = lhs == rhs && lhs_size == rhs_size;
+	size_t part = (lhs_size + 2) / 3;
+	size_t top1 = lhs_size - (part << 1);
+	size_t top2 = rhs_size - (part << 1);
+	size_t len = part + 1;
+	size_t prod_len = len << 1;
+	size_t total = lhs_size + rhs_size;
+	digit_t *prod_p1 = scratch;
+	digit_t *prod_m1 = prod_p1 + prod_len;
+	digit_t *prod_p2 = prod_m1 + prod_len;
+	// Evaluations in 1, -1 and 2 of lhs and rhs. The even parts are kept where prod_p2 goes until it is computed
+	digit_t *p1_1 = prod_p2 + prod_len, *p1_2 = p1_1 + len;
+	digit_t *m1_1 = p1_2 + len, *m1_2 = m1_1 + len;
+	digit_t *p2_1 = m1_2 + len, *p2_2 = p2_1 + len;
+	digit_t *even1 = prod_p2, *even2 = prod_p2 + len;
+	digit_t *rest = p2_2 + len;
+	if (square) {
+		p1_2 = p1_1;
+		m1_2 = m1_1;
+		p2_2 = p2_1;
+	}
 
-	digit_t quot;
-	temp1 = rhs << (len_dif * digit_len);
-	if (lhs > temp1) {
-		lhs -= temp1;
-		ans.digits.push_back(1);
+	even1[part] = addDigits(even1, lhs, part, lhs + (part << 1), top1);
+	addDigits(p1_1, even1, len, lhs + part, part);
+	// A square is never negative, so the sign only matters for distinct factors
+	bool neg_m1 = subAbsDigits(m1_1, even1, len, lhs + part, part) && !square;
+	if (!square) {
+		even2[part] = addDigits(even2, rhs, part, rhs + (part << 1), top2);
+		addDigits(p1_2, even2, len, rhs + part, part);
+		neg_m1 ^= subAbsDigits(m1_2, even2, len, rhs + part, part);
 	}
-	for (size_t i = len_dif - 1; i < lhs.digits.size(); i--) {
-		temp1 >>= int(digit_len); // Don't remove: https://www.reddit.com/r/cpp/comments/dl0c9y/passing_a_static_const_member_by_reftoconst/
+	// 4 * part2 + 2 * part1 + part0
+	std::copy(lhs + (part << 1), lhs + lhs_size, p2_1);
+	std::fill(p2_1 + top1, p2_1 + len, 0);
+	shiftFwdDigits(p2_1, p2_1, len, 1);
+	addDigits(p2_1, p2_1, len, lhs + part, part);
+	shiftFwdDigits(p2_1, p2_1, len, 1);
+	addDigits(p2_1, p2_1, len, lhs, part);
+	if (!square) {
+		std::copy(rhs + (part << 1), rhs + rhs_size, p2_2);
+		std::fill(p2_2 + top2, p2_2 + len, 0);
+		shiftFwdDigits(p2_2, p2_2, len, 1);
+		addDigits(p2_2, p2_2, len, rhs + part, part);
+		shiftFwdDigits(p2_2, p2_2, len, 1);
+		addDigits(p2_2, p2_2, len, rhs, part);
+	}
+
+	const product_t prods[5] = {
+			{ res, lhs, part, rhs, part },
+			{ res + (part << 2), lhs + (part << 1), top1, rhs + (part << 1), top2 },
+			{ prod_p1, p1_1, len, p1_2, len },
+			{ prod_m1, m1_1, len, m1_2, len },
+			{ prod_p2, p2_1, len, p2_2, len },
+	};
+	multProducts(prods, 5, rest);
+	std::fill(res + (part << 1), res + (part << 2), 0);
 
-		quot = std::min(
-				(((double_t)lhs.digits[i + rhs.digits.size()] << digit_len) |
-				 lhs.digits[i + rhs.digits.size() - 1]) / rhs.digits.back(),
-				(double_t)digit_max);
-		temp2 = temp1 * quot;
+	// Interpolation, every division is exact and every intermediate value is positive
+	subDigits(prod_m1, prod_p1, prod_len, prod_m1, prod_len);
+	shiftFwdDigits(prod_p1, prod_p1, prod_len, 1);
+	subDigits(prod_p1, prod_p1, prod_len, prod_m1, prod_len);
+	digit_t *odd = neg_m1 ? prod_p1 : prod_m1; // c1 + c3
+	digit_t *even = neg_m1 ? prod_m1 : prod_p1; // c0 + c2 + c4
+	shiftBackDigits(odd, odd, prod_len, 1);
+	shiftBackDigits(even, even, prod_len, 1);
+	subDigits(even, even, prod_len, res, part << 1);
+	subDigits(even, even, prod_len, res + (part << 2), top1 + top2);
+	subDigits(prod_p2, prod_p2, prod_len, res, part << 1);
+	subMultDigit(prod_p2, even, prod_len, 4);
+	digit_t borrow = subMultDigit(prod_p2, res + (part << 2), top1 + top2, 16);
+	subDigits(prod_p2 + top1 + top2, prod_p2 + top1 + top2, prod_len - top1 - top2, &borrow, 1);
+	shiftBackDigits(prod_p2, prod_p2, prod_len, 1);
+	subDigits(prod_p2, prod_p2, prod_len, odd, prod_len);
+	divExactDigit(prod_p2, prod_p2, prod_len, 3);
+	subDigits(odd, odd, prod_len, prod_p2, prod_len);
 
-		lhs -= temp2;
-		while (lhs < 0) {
-			lhs += temp1;
-			quot--;
+	addDigits(res + part, res + part, total - part, odd, std::min(prod_len, total - part));
+	addDigits(res + (part << 1), res + (part << 1), total - (part << 1), even, std::min(prod_len, total - (part << 1)));
+	addDigits(res + part * 3, res + part * 3, total - part * 3, prod_p2, std::min(prod_len, total - part * 3));
+}
+void hugeint::toom4 (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size, digit_t *scratch) {
+	// Both numbers are split in 4 parts and the product is evaluated in the points 0, 1, -1, 2, -2, 1/2 and infinity.
+	// Needs rhs_size > 3 * part, so that no part is empty
+	bool square = lhs == rhs && lhs_size == rhs_size;
+	size_t part = (lhs_size + 3) >> 2;
+	size_t top1 = lhs_size - part * 3;
+	size_t top2 = rhs_size - part * 3;
+	size_t len = part + 1;
+	size_t prod_len = len << 1;
+	size_t total = lhs_size + rhs_size;
+	const digit_t *nums[2] = { lhs, rhs };
+	const size_t tops[2] = { top1, top2 };
+	digit_t *prod_p1 = scratch;
+	digit_t *prod_m1 = prod_p1 + prod_len;
+	digit_t *prod_p2 = prod_m1 + prod_len;
+	digit_t *prod_m2 = prod_p2 + prod_len;
+	digit_t *prod_half = prod_m2 + prod_len;
+	// Evaluations in 1, -1, 2, -2 and 1/2 of lhs and rhs. Even and odd parts are kept where prod_m2 and prod_half
+	// go until they are computed
+	digit_t *vals[5][2];
+	for (size_t point = 0; point < 5; point++) {
+		vals[point][0] = prod_half + prod_len + len * (point << 1);
+		vals[point][1] = square ? vals[point][0] : vals[point][0] + len;
+	}
+	digit_t *even[2] = { prod_m2, prod_m2 + len };
+	digit_t *odd[2] = { prod_half, prod_half + len };
+	digit_t *rest = prod_half + prod_len + len * 10;
+	size_t count = square ? 1 : 2;
+
+	bool neg_m1 = false, neg_m2 = false;
+	for (size_t id = 0; id < count; id++) {
+		const digit_t *num = nums[id];
+		even[id][part] = addDigits(even[id], num, part, num + (part << 1), part);
+		odd[id][part] = addDigits(odd[id], num + part, part, num + part * 3, tops[id]);
+		addDigits(vals[0][id], even[id], len, odd[id], len);
+		neg_m1 ^= subAbsDigits(vals[1][id], even[id], len, odd[id], len);
+		// even = 4 * part2 + part0, odd = 8 * part3 + 2 * part1
+		std::copy(num, num + part, even[id]);
+		even[id][part] = addMultDigit(even[id], num + (part << 1), part, 4);
+		odd[id][part] = multDigit(odd[id], num + part, part, 2);
+		digit_t carry = addMultDigit(odd[id], num + part * 3, tops[id], 8);
+		addDigits(odd[id] + tops[id], odd[id] + tops[id], len - tops[id], &carry, 1);
+		addDigits(vals[2][id], even[id], len, odd[id], len);
+		neg_m2 ^= subAbsDigits(vals[3][id], even[id], len, odd[id], len);
+		// 8 * part0 + 4 * part1 + 2 * part2 + part3
+		digit_t *val = vals[4][id];
+		std::copy(num, num + part, val);
+		val[part] = 0;
+		for (size_t index = 1; index < 4; index++) {
+			shiftFwdDigits(val, val, len, 1);
+			addDigits(val, val, len, num + part * index, index == 3 ? tops[id] : part);
 		}
-		ans.digits[i] = quot;
 	}
-	if (rem) {
-		lhs >>= init_shift;
-		return lhs;
+	// A square is never negative
+	neg_m1 &= !square;
+	neg_m2 &= !square;
+
+	const product_t prods[7] = {
+			{ res, lhs, part, rhs, part },
+			{ res + part * 6, lhs + part * 3, top1, rhs + part * 3, top2 },
+			{ prod_p1, vals[0][0], len, vals[0][1], len },
+			{ prod_m1, vals[1][0], len, vals[1][1], len },
+			{ prod_p2, vals[2][0], len, vals[2][1], len },
+			{ prod_m2, vals[3][0], len, vals[3][1], len },
+			{ prod_half, vals[4][0], len, vals[4][1], len },
+	};
+	multProducts(prods, 7, rest);
+	std::fill(res + (part << 1), res + part * 6, 0);
+
+	// Interpolation, every division is exact and every intermediate value is positive
+	const digit_t *coef0 = res;
+	const digit_t *coef6 = res + part * 6;
+	size_t size0 = part << 1;
+	size_t size6 = top1 + top2;
+	digit_t borrow;
+	subDigits(prod_m1, prod_p1, prod_len, prod_m1, prod_len);
+	shiftFwdDigits(prod_p1, prod_p1, prod_len, 1);
+	subDigits(prod_p1, prod_p1, prod_len, prod_m1, prod_len);
+	digit_t *odd1 = neg_m1 ? prod_p1 : prod_m1; // c1 + c3 + c5
+	digit_t *even1 = neg_m1 ? prod_m1 : prod_p1; // c0 + c2 + c4 + c6
+	shiftBackDigits(odd1, odd1, prod_len, 1);
+	shiftBackDigits(even1, even1, prod_len, 1);
+	subDigits(prod_m2, prod_p2, prod_len, prod_m2, prod_len);
+	shiftFwdDigits(prod_p2, prod_p2, prod_len, 1);
+	subDigits(prod_p2, prod_p2, prod_len, prod_m2, prod_len);
+	digit_t *odd2 = neg_m2 ? prod_p2 : prod_m2; // c1 + 4c3 + 16c5
+	digit_t *even2 = neg_m2 ? prod_m2 : prod_p2; // c0 + 4c2 + 16c4 + 64c6
+	shiftBackDigits(odd2, odd2, prod_len, 2);
+	shiftBackDigits(even2, even2, prod_len, 1);
+
+	subDigits(even1, even1, prod_len, coef0, size0);
+	subDigits(even1, even1, prod_len, coef6, size6); // c2 + c4
+	subDigits(even2, even2, prod_len, coef0, size0);
+	borrow = subMultDigit(even2, coef6, size6, 64);
+	subDigits(even2 + size6, even2 + size6, prod_len - size6, &borrow, 1);
+	shiftBackDigits(even2, even2, prod_len, 2); // c2 + 4c4
+	subDigits(even2, even2, prod_len, even1, prod_len);
+	divExactDigit(even2, even2, prod_len, 3); // c4
+	subDigits(even1, even1, prod_len, even2, prod_len); // c2
+
+	borrow = subMultDigit(prod_half, coef0, size0, 64);
+	subDigits(prod_half + size0, prod_half + size0, prod_len - size0, &borrow, 1);
+	subMultDigit(prod_half, even1, prod_len, 16);
+	subMultDigit(prod_half, even2, prod_len, 4);
+	subDigits(prod_half, prod_half, prod_len, coef6, size6);
+	shiftBackDigits(prod_half, prod_half, prod_len, 1); // 16c1 + 4c3 + c5
+	subDigits(prod_half, prod_half, prod_len, odd1, prod_len);
+	divExactDigit(prod_half, prod_half, prod_len, 3); // 5c1 + c3
+	subDigits(odd2, odd2, prod_len, odd1, prod_len);
+	divExactDigit(odd2, odd2, prod_len, 3); // c3 + 5c5
+	multDigit(odd1, odd1, prod_len, 5);
+	subDigits(odd1, odd1, prod_len, prod_half, prod_len);
+	subDigits(odd1, odd1, prod_len, odd2, prod_len);
+	divExactDigit(odd1, odd1, prod_len, 3); // c3
+	subDigits(prod_half, prod_half, prod_len, odd1, prod_len);
+	divExactDigit(prod_half, prod_half, prod_len, 5); // c1
+	subDigits(odd2, odd2, prod_len, odd1, prod_len);
+	divExactDigit(odd2, odd2, prod_len, 5); // c5
+
+	const digit_t *coefs[5] = { prod_half, even1, odd1, even2, odd2 };
+	for (size_t index = 1; index < 6; index++) {
+		size_t pos = part * index;
+		addDigits(res + pos, res + pos, total - pos, coefs[index - 1], std::min(prod_len, total - pos));
+	}
+}
+#ifdef DIGIT_64
+void hugeint::nttMult (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size) {
+	// Explanation for the number theoretic transform: https://en.wikipedia.org/wiki/Discrete_Fourier_transform_over_a_ring
+	// The convolution is done modulo 3 primes, then the digits are rebuilt with the chinese remainder theorem
+	bool square = lhs == rhs && lhs_size == rhs_size;
+	size_t size1 = lhs_size;
+	size_t size2 = rhs_size;
+	size_t len = 1;
+	while (len < size1 + size2 - 1) {
+		len <<= 1;
+	}
+
+	// The transforms modulo each prime are independent of each other
+	std::vector <uint64_t> conv[3];
+	std::vector <std::function <void ()>> tasks;
+	for (int id = 0; id < 3; id++) {
+		tasks.push_back([=, &conv] {
+			const ntt_prime &prime = ntt_primes[id];
+			std::vector <uint64_t> vals1(len, 0), vals2;
+			for (size_t index = 0; index < size1; index++) {
+				vals1[index] = prime.toForm(lhs[index]);
+			}
+			std::vector <uint64_t> roots = prime.makeRoots(len, false);
+			prime.forward(vals1.data(), len, roots);
+			if (square) {
+				for (size_t index = 0; index < len; index++) {
+					vals1[index] = prime.mult(vals1[index], vals1[index]);
+				}
+			}
+			else {
+				vals2.assign(len, 0);
+				for (size_t index = 0; index < size2; index++) {
+					vals2[index] = prime.toForm(rhs[index]);
+				}
+				prime.forward(vals2.data(), len, roots);
+				for (size_t index = 0; index < len; index++) {
+					vals1[index] = prime.mult(vals1[index], vals2[index]);
+				}
+			}
+			roots = prime.makeRoots(len, true);
+			prime.backward(vals1.data(), len, roots);
+			// Multiplying by len^-1 in normal form also takes the values out of Montgomery form
+			uint64_t scale = prime.pow(prime.toForm(len), prime.mod - 2);
+			scale = prime.mult(scale, 1);
+			for (size_t index = 0; index < len; index++) {
+				vals1[index] = prime.mult(vals1[index], scale);
+			}
+			conv[id].swap(vals1);
+		});
+	}
+	if (runParallel(size2)) {
+		runTasks(tasks);
 	}
 	else {
-		ans.clearZeros();
-		return ans;
+		for (std::function <void ()> &task : tasks) {
+			task();
+		}
+	}
+
+	// Garner's algorithm: value = r0 + p0 * (t1 + p1 * t2)
+	const ntt_prime &prime0 = ntt_primes[0], &prime1 = ntt_primes[1], &prime2 = ntt_primes[2];
+	uint64_t inv01 = prime1.pow(prime1.toForm(prime0.mod % prime1.mod), prime1.mod - 2);
+	uint64_t mod0_2 = prime2.toForm(prime0.mod % prime2.mod);
+	uint64_t inv012 = prime2.pow(prime2.toForm(prime2.mult(mod0_2, prime1.mod % prime2.mod)), prime2.mod - 2);
+	unsigned __int128 mod01 = (unsigned __int128)prime0.mod * prime1.mod;
+
+	unsigned __int128 carry = 0;
+	uint64_t carry_high = 0;
+	for (size_t index = 0; index < size1 + size2; index++) {
+		if (index < size1 + size2 - 1) {
+			uint64_t rem0 = conv[0][index], rem1 = conv[1][index], rem2 = conv[2][index];
+			uint64_t term1 = prime1.mult(prime1.sub(rem1, rem0 % prime1.mod), inv01);
+			uint64_t low2 = prime2.add(rem0 % prime2.mod, prime2.mult(term1, mod0_2));
+			uint64_t term2 = prime2.mult(prime2.sub(rem2, low2), inv012);
+
+			// value = rem0 + mod0 * term1 + mod01 * term2, up to 184 bits long
+			unsigned __int128 low = (unsigned __int128)prime0.mod * term1 + rem0;
+			unsigned __int128 part_low = (unsigned __int128)(uint64_t)mod01 * term2;
+			unsigned __int128 part_high = (unsigned __int128)(uint64_t)(mod01 >> 64) * term2 + (part_low >> 64);
+			part_low = (uint64_t)part_low | (part_high << 64);
+			part_high >>= 64;
+			low += part_low;
+			part_high += low < part_low;
+
+			carry += low;
+			carry_high += (uint64_t)part_high + (carry < low);
+		}
+		res[index] = (uint64_t)carry;
+		carry = (carry >> 64) | ((unsigned __int128)carry_high << 64);
+		carry_high = 0;
 	}
 }
-hugeint hugeint::calculateDiv (const hugeint &lhs, const hugeint &rhs) {
-	if (!(bool)rhs) {
-		throw (std::invalid_argument("Division by 0"));
+#endif
+size_t hugeint::multScratch (size_t size1, size_t size2) {
+#ifdef DIGIT_64
+	if (std::min(size1, size2) >= ntt_threshold) {
+		return 0;
+	}
+#endif
+	// Every algorithm uses at most 5 * size + 64 digits for itself, then recurses on at most size / 2 + 2 digits.
+	// Unbalanced products are split in blocks, so they never need more than a product twice the smaller size
+	size_t size = std::min(std::max(size1, size2), std::min(size1, size2) << 1);
+	size_t total = 64;
+	while (size >= 5) {
+		total += (size << 2) + size + 64;
+		size = (size >> 1) + 2;
 	}
-	return simpleDiv(lhs, rhs);
+	return total;
 }
-hugeint hugeint::calculateMod (const hugeint &lhs, const hugeint &rhs) {
-	if (!(bool)rhs) {
-		throw (std::invalid_argument("Division by 0"));
+void hugeint::multProducts (const product_t *prods, size_t count, digit_t *scratch) {
+	size_t size = 0;
+	for (size_t index = 0; index < count; index++) {
+		size = std::max(size, std::max(prods[index].lhs_size, prods[index].rhs_size));
+	}
+	if (!runParallel(size)) {
+		for (size_t index = 0; index < count; index++) {
+			const product_t &prod = prods[index];
+			multAlgorithm(prod.res, prod.lhs, prod.lhs_size, prod.rhs, prod.rhs_size, scratch);
+		}
+		return;
 	}
-	return simpleDiv(lhs, rhs, true);
+	// The products run at the same time, so each of them gets a scratch buffer of its own
+	std::vector <std::function <void ()>> tasks;
+	for (size_t index = 0; index < count; index++) {
+		const product_t &prod = prods[index];
+		tasks.push_back([&prod] {
+			std::vector <digit_t> buffer(multScratch(prod.lhs_size, prod.rhs_size));
+			multAlgorithm(prod.res, prod.lhs, prod.lhs_size, prod.rhs, prod.rhs_size, buffer.data());
+		});
+	}
+	runTasks(tasks);
 }
-
-void hugeint::setRamdon (size_t size, bool rand_sign) {
-	std::random_device seed;
-	std::default_random_engine generator(seed());
-	std::uniform_int_distribution <digit_t> distribution(0, digit_max);
-	auto random_digit = std::bind(distribution, generator);
-	neg = rand_sign && (random_digit() & 1);
-	digits.clear();
-	for (size_t index = 0; index < (size >> digit_log_len); index++) {
-		digits.push_back(random_digit());
+void hugeint::multAlgorithm (digit_t *res, const digit_t *lhs, size_t lhs_size, const digit_t *rhs, size_t rhs_size, digit_t *scratch) {
+	if (lhs_size < rhs_size) {
+		std::swap(lhs, rhs);
+		std::swap(lhs_size, rhs_size);
 	}
-	if (size & (digit_len - 1)) {
-		digits.push_back(random_digit() & (((digit_t)1 << (size & (digit_len - 1))) - 1));
+	if (lhs == rhs && lhs_size == rhs_size) {
+		squareAlgorithm(res, lhs, lhs_size, scratch);
+		return;
 	}
-	clearZeros();
-	if (neg) {
+	if (rhs_size == 0) {
+		std::fill(res, res + lhs_size, 0);
+		return;
+	}
+	if (rhs_size < std::max(karatsuba_threshold, (size_t)2)) {
+		simpleMult(res, lhs, lhs_size, rhs, rhs_size);
+		return;
+	}
+#ifdef DIGIT_64
+	if (rhs_size >= ntt_threshold) {
+		nttMult(res, lhs, lhs_size, rhs, rhs_size);
+		return;
+	}
+#endif
+	if (lhs_size >= rhs_size << 1) {
+		unbalancedMult(res, lhs, lhs_size, rhs, rhs_size, scratch);
+		return;
+	}
+	// Below 4 digits the evaluated parts would not get any smaller
+	if (rhs_size >= std::max(toom4_threshold, (size_t)4) && rhs_size > ((lhs_size + 3) >> 2) * 3) {
+		toom4(res, lhs, lhs_size, rhs, rhs_size, scratch);
+	}
+	else if (rhs_size >= std::max(toom3_threshold, (size_t)4) && rhs_size > ((lhs_size + 2) / 3) << 1) {
+		toom3(res, lhs, lhs_size, rhs, rhs_size, scratch);
+	}
+	else {
+		karatsuba(res, lhs, lhs_size, rhs, rhs_size, scratch);
+	}
+}
+void hugeint::squareAlgorithm (digit_t *res, const digit_t *num, size_t size, digit_t *scratch) {
+	if (size < std::max(karatsuba_square_threshold, (size_t)2)) {
+		simpleSquare(res, num, size);
+		return;
+	}
+#ifdef DIGIT_64
+	if (size >= ntt_threshold) {
+		nttMult(res, num, size, num, size);
+		return;
+	}
+#endif
+	if (size >= std::max(toom4_threshold, (size_t)4)) {
+		toom4(res, num, size, num, size, scratch);
+	}
+	else if (size >= std::max(toom3_threshold, (size_t)4)) {
+		toom3(res, num, size, num, size, scratch);
+	}
+	else {
+		karatsubaSquare(res, num, size, scratch);
+	}
+}
+hugeint hugeint::calculateSquare (const hugeint &num) {
+	hugeint num_abs;
+	const hugeint *calc = &num;
+	if (num.neg) {
+		num_abs = -num;
+		calc = &num_abs;
+	}
+	hugeint ans;
+	size_t size = calc->digits.size();
+	if (size) {
+		ans.digits.resize(size << 1);
+		std::vector <digit_t> scratch(multScratch(size, size));
+		squareAlgorithm(ans.digits.data(), calc->digits.data(), size, scratch.data());
+		ans.clearZeros();
+	}
+	return ans;
+}
+hugeint hugeint::calculateMult (const hugeint &lhs, const hugeint &rhs) {
+	if (&lhs == &rhs) {
+		return calculateSquare(lhs);
+	}
+	// The algorithms work on absolute values, a copy is made only for negative numbers
+	hugeint lhs_abs, rhs_abs;
+	const hugeint *calc1 = &lhs, *calc2 = &rhs;
+	if (lhs.neg) {
+		lhs_abs = -lhs;
+		calc1 = &lhs_abs;
+	}
+	if (rhs.neg) {
+		rhs_abs = -rhs;
+		calc2 = &rhs_abs;
+	}
+	hugeint ans;
+	size_t size1 = calc1->digits.size();
+	size_t size2 = calc2->digits.size();
+	if (size1 && size2) {
+		ans.digits.resize(size1 + size2);
+		std::vector <digit_t> scratch(multScratch(size1, size2));
+		multAlgorithm(ans.digits.data(), calc1->digits.data(), size1, calc2->digits.data(), size2, scratch.data());
+		ans.clearZeros();
+	}
+	if (lhs.neg ^ rhs.neg) {
+		ans.negate();
+	}
+	return ans;
+}
+hugeint hugeint::calculateMult (const hugeint &lhs, scalar_t rhs) {
+	hugeint ret = lhs;
+	ret.calculateMult(rhs);
+	return ret;
+}
+hugeint hugeint::calculateMult (scalar_t lhs, const hugeint &rhs) {
+	return calculateMult(rhs, lhs);
+}
+void hugeint::calculateMult (scalar_t rhs) {
+	multiplyDigit(rhs.abs());
+	if (rhs.neg) {
 		negate();
 	}
 }
 
-void hugeint::calculateGcd (hugeint other) {
-	while (other) {
-		*this = (*this) % other;
-		if (*this) {
-			other = other % (*this);
-		}
-		else {
-			*this = other;
-			break;
+void hugeint::divExactDigits (digit_t *quot, digit_t *rem, size_t size, const digit_t *div, size_t div_size, digit_t inv, digit_t *scratch) {
+	// Hensel division: quot gets the low size digits of rem / div for an odd div, which only depend on the low size
+	// digits of rem and div. rem is destroyed and inv is invertOdd(div[0])
+	div_size = std::min(div_size, size);
+	if (size < std::max(burnikel_ziegler_threshold, (size_t)2)) {
+		for (size_t index = 0; index < size; index++) {
+			quot[index] = rem[index] * inv;
+			size_t len = std::min(div_size, size - index);
+			digit_t borrow = subMultDigit(rem + index, div, len, quot[index]);
+			if (index + len < size) {
+				subDigits(rem + index + len, rem + index + len, size - index - len, &borrow, 1);
+			}
 		}
+		return;
 	}
+	// The low half of the quotient comes first, its product with div is taken off the rest, then the high half
+	size_t low = size >> 1, high = size - low;
+	divExactDigits(quot, rem, low, div, div_size, inv, scratch);
+	digit_t *prod = scratch;
+	multAlgorithm(prod, quot, low, div, div_size, prod + low + div_size);
+	subDigits(rem + low, rem + low, high, prod + low, std::min(high, div_size));
+	divExactDigits(quot + low, rem + low, high, div, div_size, inv, scratch);
 }
-
-void hugeint::calculatePow (exp_t exponent) {
-	if (exponent == 0) {
-		neg = false;
-		digits.clear();
-		digits.push_back(1);
-		return;
+size_t hugeint::divExactScratch (size_t size) {
+	if (size < burnikel_ziegler_threshold) {
+		return 0;
 	}
-	while (!(exponent & 1) && exponent) {
-		exponent >>= 1;
-		*this = calculateMult(*this, *this);
+#ifdef DIGIT_64
+	return (size << 1) + multScratch(size, std::min(size, ntt_threshold - 1));
+#else
+	return (size << 1) + multScratch(size, size);
+#endif
+}
+hugeint::digit_t hugeint::simpleDiv (digit_t *quot, digit_t *rem, size_t rem_size, const digit_t *div, size_t div_size) {
+	size_t quot_size = rem_size - div_size;
+	digit_t top = 0;
+	if (!lessDigits(rem + quot_size, div, div_size)) {
+		subDigits(rem + quot_size, rem + quot_size, div_size, div, div_size);
+		top = 1;
 	}
-	hugeint power = *this;
-	exponent >>= 1;
-	while (exponent) {
-		power *= power;
-		if (exponent & 1) {
-			*this = calculateMult(*this, power);
+	digit_t div1 = div[div_size - 1];
+	digit_t div0 = div_size > 1 ? div[div_size - 2] : 0;
+	for (size_t index = quot_size - 1; index < quot_size; index--) {
+		digit_t *part = rem + index;
+		// The estimate from the top two digits of div is at most one too big after the correction with the third one
+		double_t num = ((double_t)part[div_size] << digit_len) | part[div_size - 1];
+		double_t est = std::min(num / div1, (double_t)digit_max);
+		double_t rest = num - est * div1;
+		digit_t low = div_size > 1 ? part[div_size - 2] : 0;
+		while (rest <= digit_max && est * div0 > ((rest << digit_len) | low)) {
+			est--;
+			rest += div1;
 		}
-		exponent >>= 1;
+		digit_t borrow = subMultDigit(part, div, div_size, est);
+		bool over = part[div_size] < borrow;
+		part[div_size] -= borrow;
+		if (over) {
+			est--;
+			part[div_size] += addDigits(part, part, div_size, div, div_size);
+		}
+		quot[index] = est;
 	}
+	return top;
 }
-void hugeint::calculatePow (exp_t exponent, const hugeint &to_mod) {
-	while (!(exponent & 1) && exponent) {
-		exponent >>= 1;
-		*this = calculateMult(*this, *this);
+hugeint::digit_t hugeint::burnikelZiegler (digit_t *quot, digit_t *rem, const digit_t *div, size_t size, digit_t *scratch) {
+	// Divides 2 * size digits by size digits. Each half of the quotient comes from a recursive division by the top
+	// half of div, which is then corrected by subtracting its product with the bottom half of div
+	if (size < std::max(burnikel_ziegler_threshold, (size_t)2)) {
+		return simpleDiv(quot, rem, size << 1, div, size);
 	}
-	hugeint power = *this;
-	exponent >>= 1;
-	while (exponent) {
-		power *= power;
-		power %= to_mod;
-		if (exponent & 1) {
-			*this = calculateMult(*this, power);
-			*this = calculateMod(*this, to_mod);
-		}
-		exponent >>= 1;
+	const digit_t one = 1;
+	size_t low = size >> 1, high = size - low;
+
+	digit_t top = burnikelZiegler(quot + low, rem + (low << 1), div + low, high, scratch);
+	multAlgorithm(scratch, quot + low, high, div, low, scratch + size);
+	digit_t borrow = subDigits(rem + low, rem + low, size, scratch, size);
+	if (top) {
+		borrow += subDigits(rem + size, rem + size, low, div, low);
+	}
+	while (borrow) {
+		top -= subDigits(quot + low, quot + low, high, &one, 1);
+		borrow -= addDigits(rem + low, rem + low, size, div, size);
 	}
+
+	digit_t low_top = burnikelZiegler(quot, rem + high, div + high, low, scratch);
+	multAlgorithm(scratch, div, high, quot, low, scratch + size);
+	borrow = subDigits(rem, rem, size, scratch, size);
+	if (low_top) {
+		borrow += subDigits(rem + low, rem + low, high, div, high);
+	}
+	while (borrow) {
+		subDigits(quot, quot, low, &one, 1);
+		borrow -= addDigits(rem, rem, size, div, size);
+	}
+	return top;
 }
+void hugeint::invertDigits (digit_t *inv, const digit_t *div, size_t size, digit_t *scratch) {
+	// Writes size + 1 digits with div * inv < B^(2 * size) < div * (inv + 2), where B is the digit base. This is the
+	// approximate reciprocal of Brent and Zimmermann: the reciprocal of the top half of div gets one Newton step, which
+	// only needs the top half of the error
+	if (size < std::max(newton_threshold, (size_t)3)) {
+		digit_t *num = scratch;
+		std::fill(num, num + (size << 1), (digit_t)digit_max);
+		inv[size] = divAlgorithm(inv, num, size << 1, div, size, num + (size << 1));
+		return;
+	}
+	const digit_t one = 1;
+	size_t low = (size - 1) >> 1, high = size - low;
+	digit_t *high_inv = inv + low;
+	invertDigits(high_inv, div + low, high, scratch);
 
-void hugeint::calculateNthRoot (root_t degree) {
-	hugeint ans;
-	for (size_t pos = size() / degree; pos <= size() / degree; pos--) {
-		ans.flipBit(pos);
-		if (pow(ans, degree) > *this) {
-			ans.flipBit(pos);
+	// The error is B^(size + high) - div * high_inv, which has to be positive
+	digit_t *err = scratch;
+	multAlgorithm(err, div, size, high_inv, high + 1, err + size + high + 1);
+	while (err[size + high]) {
+		subDigits(high_inv, high_inv, high + 1, &one, 1);
+		subDigits(err, err, size + high + 1, div, size);
+	}
+	bitwiseDigits <op_not>(err, err, (const digit_t *)nullptr, size + high);
+	addDigits(err, err, size + high, &one, 1);
+
+	digit_t *corr = err + size + high + 1;
+	multAlgorithm(corr, err + low, high << 1, high_inv, high + 1, corr + 3 * high + 1);
+	std::fill(inv, inv + low, 0);
+	addDigits(inv, inv, size + 1, corr + (high << 1) - low, size + 1);
+}
+hugeint::digit_t hugeint::newtonDiv (digit_t *quot, digit_t *rem, const digit_t *div, const digit_t *inv, size_t size, digit_t *scratch) {
+	// Divides 2 * size digits by size digits with the reciprocal from invertDigits. The quotient estimated from the top
+	// half of rem is at most a few units too small, which the last loop fixes
+	const digit_t one = 1;
+	digit_t *rem_high = rem + size;
+	digit_t top = 0;
+	if (!lessDigits(rem_high, div, size)) {
+		subDigits(rem_high, rem_high, size, div, size);
+		top = 1;
+	}
+	// inv is B^size plus its low digits, so the estimate is rem_high plus the top half of rem_high times the low digits
+	digit_t *prod = scratch;
+	multAlgorithm(prod, rem_high, size, inv, size, prod + (size << 1));
+	addDigits(quot, prod + size, size, rem_high, size);
+	multAlgorithm(prod, quot, size, div, size, prod + (size << 1));
+	subDigits(rem, rem, size << 1, prod, size << 1);
+	while (rem[size] || !lessDigits(rem, div, size)) {
+		top += addDigits(quot, quot, size, &one, 1);
+		rem[size] -= subDigits(rem, rem, size, div, size);
+	}
+	return top;
+}
+size_t hugeint::divScratch (size_t rem_size, size_t div_size) {
+	if (div_size < burnikel_ziegler_threshold || rem_size - div_size < burnikel_ziegler_threshold) {
+		return 0;
+	}
+	// Products past ntt_threshold need no scratch, the smaller ones deeper in the recursion still do
+	size_t size = div_size + 2;
+#ifdef DIGIT_64
+	size_t mult = multScratch(size, std::min(size, ntt_threshold - 1));
+#else
+	size_t mult = multScratch(size, size);
+#endif
+	// A product of a quotient block with part of div, or the reciprocal of div with the buffers of its Newton steps
+	if (div_size >= newton_threshold && rem_size - div_size >= 4 * div_size) {
+		return div_size + 1 + 5 * size + mult;
+	}
+	return div_size + mult;
+}
+hugeint::digit_t hugeint::divAlgorithm (digit_t *quot, digit_t *rem, size_t rem_size, const digit_t *div, size_t div_size, digit_t *scratch) {
+	size_t quot_size = rem_size - div_size;
+	if (div_size < burnikel_ziegler_threshold || quot_size < burnikel_ziegler_threshold) {
+		return simpleDiv(quot, rem, rem_size, div, div_size);
+	}
+	// Past newton_threshold the reciprocal of div is computed once and the full blocks are divided with it. Finding it
+	// costs about as much as a couple of blocks, so it only pays off for quotients of several blocks
+	bool newton = div_size >= newton_threshold && quot_size >= 4 * div_size;
+	digit_t *inv = scratch;
+	if (newton) {
+		scratch += div_size + 1;
+		invertDigits(inv, div, div_size, scratch);
+	}
+	// The quotient is found in blocks of div_size digits from the top, each one a division of 2 * div_size digits.
+	// The top block can be shorter, then it is divided by the top digits of div and corrected like in burnikelZiegler
+	const digit_t one = 1;
+	size_t first = quot_size % div_size ? quot_size % div_size : div_size;
+	digit_t *block_quot = quot + quot_size - first;
+	digit_t *block_rem = rem + quot_size - first;
+	digit_t top;
+	if (first == div_size) {
+		top = newton ?
+		      newtonDiv(block_quot, block_rem, div, inv, div_size, scratch) :
+		      burnikelZiegler(block_quot, block_rem, div, div_size, scratch);
+	}
+	else {
+		size_t rest = div_size - first;
+		top = burnikelZiegler(block_quot, block_rem + rest, div + rest, first, scratch);
+		multAlgorithm(scratch, block_quot, first, div, rest, scratch + div_size);
+		digit_t borrow = subDigits(block_rem, block_rem, div_size, scratch, div_size);
+		if (top) {
+			borrow += subDigits(block_rem + first, block_rem + first, rest, div, rest);
+		}
+		while (borrow) {
+			top -= subDigits(block_quot, block_quot, first, &one, 1);
+			borrow -= addDigits(block_rem, block_rem, div_size, div, div_size);
+		}
+	}
+	for (size_t pos = quot_size - first; pos; pos -= div_size) {
+		if (newton) {
+			newtonDiv(quot + pos - div_size, rem + pos - div_size, div, inv, div_size, scratch);
+		}
+		else {
+			burnikelZiegler(quot + pos - div_size, rem + pos - div_size, div, div_size, scratch);
+		}
+	}
+	return top;
+}
+void hugeint::calculateDivMod (const hugeint &lhs, const hugeint &rhs, hugeint *quot, hugeint *rem, round_t mode) {
+	if (!(bool)rhs) {
+		throw (std::invalid_argument("Division by 0"));
+	}
+	// The quotient is rounded toward 0 and the remainder has the sign of lhs
+	hugeint lhs_abs, rhs_abs;
+	const hugeint *calc1 = &lhs, *calc2 = &rhs;
+	if (lhs.neg) {
+		lhs_abs = -lhs;
+		calc1 = &lhs_abs;
+	}
+	if (rhs.neg) {
+		rhs_abs = -rhs;
+		calc2 = &rhs_abs;
+	}
+	size_t size1 = calc1->digits.size();
+	size_t size2 = calc2->digits.size();
+	hugeint ans_quot, ans_rem;
+	if (size1 < size2) {
+		ans_rem = *calc1;
+	}
+	else if (size2 == 1) {
+		ans_quot.digits.resize(size1);
+		ans_rem = divDigit(ans_quot.digits.data(), calc1->digits.data(), size1, calc2->digits[0]);
+	}
+	else if (size2 == 2) {
+		ans_quot.digits.resize(size1 - 1);
+		ans_rem.digits.resize(2);
+		divTwoDigits(ans_quot.digits.data(), calc1->digits.data(), size1, calc2->digits.data(), ans_rem.digits.data());
+	}
+	else {
+		// Both are shifted so the top bit of the divisor is set, the dividend gets one more digit for the bits shifted out
+		int shift = (digit_len - calc2->size() % digit_len) % digit_len;
+		std::vector <digit_t> num(size1 + 1), div(size2);
+		if (shift) {
+			shiftFwdDigits(div.data(), calc2->digits.data(), size2, shift);
+			num[size1] = shiftFwdDigits(num.data(), calc1->digits.data(), size1, shift);
+		}
+		else {
+			std::copy(calc2->digits.begin(), calc2->digits.end(), div.begin());
+			std::copy(calc1->digits.begin(), calc1->digits.end(), num.begin());
+		}
+		ans_quot.digits.resize(size1 + 1 - size2);
+		std::vector <digit_t> scratch(divScratch(size1 + 1, size2));
+		divAlgorithm(ans_quot.digits.data(), num.data(), size1 + 1, div.data(), size2, scratch.data());
+		if (shift) {
+			shiftBackDigits(num.data(), num.data(), size2, shift);
+		}
+		ans_rem.digits.assign(num.begin(), num.begin() + size2);
+	}
+	ans_quot.clearZeros();
+	ans_rem.clearZeros();
+	if (lhs.neg != rhs.neg) {
+		ans_quot.negate();
+	}
+	if (lhs.neg) {
+		ans_rem.negate();
+	}
+	// Floor and ceil move the quotient one step away from truncation when the remainder has the wrong sign
+	if (mode != round_trunc && (bool)ans_rem) {
+		if ((mode == round_floor) == (lhs.neg != rhs.neg)) {
+			if (mode == round_floor) {
+				ans_quot.decrement();
+				ans_rem.calculateAdd(rhs);
+			}
+			else {
+				ans_quot.increment();
+				ans_rem.calculateAdd(rhs, true);
+			}
+		}
+	}
+	// quot and rem can be lhs or rhs, so they are only written at the end
+	if (quot) {
+		*quot = std::move(ans_quot);
+	}
+	if (rem) {
+		*rem = std::move(ans_rem);
+	}
+}
+hugeint hugeint::calculateDivExact (const hugeint &lhs, const hugeint &rhs) {
+	if (!(bool)rhs) {
+		throw (std::invalid_argument("Division by 0"));
+	}
+	// The trailing zeros of rhs are shifted out of both so that the divisor is odd, then only the low digits as many as
+	// the quotient has are needed
+	hugeint num = abs(lhs), div = abs(rhs);
+	size_t zeros = 0;
+	while (!div.digits[zeros >> digit_log_len]) {
+		zeros += digit_len;
+	}
+	while (!((div.digits[zeros >> digit_log_len] >> (zeros & (digit_len - 1))) & 1)) {
+		zeros++;
+	}
+	if (zeros) {
+		num.shiftBack(zeros);
+		div.shiftBack(zeros);
+	}
+	hugeint quot;
+	size_t num_size = num.digits.size(), div_size = div.digits.size();
+	if (num_size < div_size) {
+		return quot;
+	}
+	size_t size = num_size - div_size + 1;
+	if (size < std::max(burnikel_ziegler_threshold, (size_t)2) << 1) {
+		quot.digits.resize(size);
+		std::vector <digit_t> scratch(divExactScratch(size));
+		divExactDigits(quot.digits.data(), num.digits.data(), size, div.digits.data(), div_size, invertOdd(div.digits[0]), scratch.data());
+	}
+	else {
+		// Jebelean's bidirectional division: the low half of the quotient comes from Hensel division and the high half
+		// from an ordinary division of the top digits, each half the size of the whole. The top digits of div are
+		// enough to get the high half within 1, and the digit where the halves overlap fixes it
+		size_t low = size >> 1, high = size - low;
+		size_t cut = div_size > high + 2 ? div_size - high - 2 : 0;
+		hugeint top_num, top_div;
+		top_num.digits.assign(num.digits.begin() + cut + low, num.digits.end());
+		top_div.digits.assign(div.digits.begin() + cut, div.digits.end());
+		calculateDivMod(top_num, top_div, &quot, nullptr);
+
+		std::vector <digit_t> low_quot(low + 1), scratch(divExactScratch(low + 1));
+		divExactDigits(low_quot.data(), num.digits.data(), low + 1, div.digits.data(), div_size, invertOdd(div.digits[0]), scratch.data());
+		digit_t diff = (quot.digits.empty() ? 0 : quot.digits[0]) - low_quot[low];
+		if (diff == 1) {
+			quot.decrement();
+		}
+		else if (diff == digit_max) {
+			quot.increment();
+		}
+		quot.digits.insert(quot.digits.begin(), low_quot.begin(), low_quot.begin() + low);
+	}
+	quot.clearZeros();
+	if (lhs.neg != rhs.neg) {
+		quot.negate();
+	}
+	return quot;
+}
+hugeint hugeint::calculateDiv (const hugeint &lhs, const hugeint &rhs) {
+	hugeint quot;
+	calculateDivMod(lhs, rhs, &quot, nullptr);
+	return quot;
+}
+hugeint hugeint::calculateMod (const hugeint &lhs, const hugeint &rhs) {
+	hugeint rem;
+	calculateDivMod(lhs, rhs, nullptr, &rem);
+	return rem;
+}
+
+hugeint hugeint::calculateDiv (const hugeint &lhs, scalar_t rhs) {
+	if (!rhs.val && !rhs.neg) {
+		throw (std::invalid_argument("Division by 0"));
+	}
+	hugeint ret = abs(lhs);
+	ret.divideDigit(rhs.abs());
+	if (lhs.neg != rhs.neg) {
+		ret.negate();
+	}
+	return ret;
+}
+hugeint hugeint::calculateDiv (scalar_t lhs, const hugeint &rhs) {
+	return calculateDiv(hugeint(lhs), rhs);
+}
+hugeint hugeint::calculateMod (const hugeint &lhs, scalar_t rhs) {
+	if (!rhs.val && !rhs.neg) {
+		throw (std::invalid_argument("Division by 0"));
+	}
+	// The remainder has the sign of lhs, only a negative lhs needs a copy to take its absolute value
+	hugeint ret;
+	if (lhs.neg) {
+		hugeint pos = -lhs;
+		ret = modDigit(pos.digits.data(), pos.digits.size(), rhs.abs());
+		ret.negate();
+	}
+	else {
+		ret = modDigit(lhs.digits.data(), lhs.digits.size(), rhs.abs());
+	}
+	return ret;
+}
+hugeint hugeint::calculateMod (scalar_t lhs, const hugeint &rhs) {
+	return calculateMod(hugeint(lhs), rhs);
+}
+
+void hugeint::setRamdon (size_t size, bool rand_sign) {
+	std::random_device seed;
+	std::default_random_engine generator(seed());
+	std::uniform_int_distribution <digit_t> distribution(0, digit_max);
+	auto random_digit = std::bind(distribution, generator);
+	neg = rand_sign && (random_digit() & 1);
+	digits.clear();
+	for (size_t index = 0; index < (size >> digit_log_len); index++) {
+		digits.push_back(random_digit());
+	}
+	if (size & (digit_len - 1)) {
+		digits.push_back(random_digit() & (((digit_t)1 << (size & (digit_len - 1))) - 1));
+	}
+	clearZeros();
+	if (neg) {
+		negate();
+	}
+}
+
+struct hugeint::gcd_matrix_t {
+	// The numbers at the start are (m00 * a + m01 * b, m10 * a + m11 * b) in terms of the current ones. det_neg tells
+	// if the determinant is -1 instead of 1
+	hugeint m00 = 1, m01 = 0, m10 = 0, m11 = 1;
+	bool det_neg = false;
+
+	// Appends the steps of another matrix
+	void mult (const gcd_matrix_t &other) {
+		hugeint n00 = m00 * other.m00 + m01 * other.m10, n01 = m00 * other.m01 + m01 * other.m11;
+		hugeint n10 = m10 * other.m00 + m11 * other.m10, n11 = m10 * other.m01 + m11 * other.m11;
+		m00 = std::move(n00);
+		m01 = std::move(n01);
+		m10 = std::move(n10);
+		m11 = std::move(n11);
+		det_neg = det_neg != other.det_neg;
+	}
+	// Appends a division step with quotient q, which is multiplying by (q, 1; 1, 0)
+	void divStep (const hugeint &q) {
+		m01 += m00 * q;
+		m11 += m10 * q;
+		std::swap(m00, m01);
+		std::swap(m10, m11);
+		det_neg = !det_neg;
+	}
+	// Appends the steps of a Lehmer matrix. Its entries can't be negative, and neither can the ones of the matrices it
+	// is appended to, so the rows are updated in place on their digits
+	void lehmerStep (const lehmer_t &mat, hugeint &temp) {
+		lehmerRow(m00, m01, mat, temp);
+		lehmerRow(m10, m11, mat, temp);
+	}
+	// Swaps a and b, which is multiplying by (0, 1; 1, 0)
+	void swapStep () {
+		std::swap(m00, m01);
+		std::swap(m10, m11);
+		det_neg = !det_neg;
+	}
+	static void lehmerRow (hugeint &lhs, hugeint &rhs, const lehmer_t &mat, hugeint &temp) {
+		size_t size = std::max(lhs.digits.size(), rhs.digits.size()) + 1;
+		lhs.digits.resize(size, 0);
+		rhs.digits.resize(size, 0);
+		temp.digits.resize(size);
+		multDigit(temp.digits.data(), lhs.digits.data(), size, mat.u01);
+		addMultDigit(temp.digits.data(), rhs.digits.data(), size, mat.u11);
+		multDigit(lhs.digits.data(), lhs.digits.data(), size, mat.u00);
+		addMultDigit(lhs.digits.data(), rhs.digits.data(), size, mat.u10);
+		std::swap(rhs.digits, temp.digits);
+		lhs.clearZeros();
+		rhs.clearZeros();
+	}
+};
+
+bool hugeint::lehmerMatrix (lehmer_t &mat, double_t a, double_t b) {
+	// Moller's variant of Lehmer's algorithm on the leading 2 * digit_len bits a and b of two numbers, shifted by the
+	// same amount so that the largest one has its top bit set. Each step takes one quotient, one less than the real one
+	// when the real one would leave the number below 2 * B, and the steps stop before either number gets there, which
+	// guarantees they are also valid for the whole numbers. Once the one being reduced is below B ^ 1.5, the steps go on
+	// with single digits on the top bits of both. Returns false if no step could be taken
+	const double_t min_double = (double_t)2 << digit_len, max_single = (double_t)1 << (digit_len + digit_len / 2);
+	const digit_t min_single = (digit_t)2 << (digit_len / 2);
+	if (a < min_double || b < min_double) {
+		return false;
+	}
+	digit_t u00 = 1, u01 = 0, u10 = 0, u11 = 1;
+	if (a > b) {
+		a -= b;
+		if (a < min_double) {
+			return false;
+		}
+		u01 = 1;
+	}
+	else {
+		b -= a;
+		if (b < min_double) {
+			return false;
+		}
+		u10 = 1;
+	}
+	// The steps alternate between the numbers, starting with the one with the larger leading digit
+	bool reduce_a = a >> digit_len >= b >> digit_len, single = false;
+	while (!single) {
+		double_t &num = reduce_a ? a : b, &den = reduce_a ? b : a;
+		digit_t &col0 = reduce_a ? u01 : u00, &col1 = reduce_a ? u11 : u10;
+		digit_t row0 = reduce_a ? u00 : u01, row1 = reduce_a ? u10 : u11;
+		if (num >> digit_len == den >> digit_len) {
+			break;
+		}
+		if (num < max_single) {
+			single = true;
+			break;
+		}
+		num -= den;
+		if (num < min_double) {
+			break;
+		}
+		digit_t q = 1;
+		if (num >> digit_len > den >> digit_len) {
+			q = (digit_t)smallQuotient(num, den);
+			num -= q * den;
+			if (num >= min_double) {
+				q++;
+			}
+		}
+		col0 += q * row0;
+		col1 += q * row1;
+		if (num < min_double) {
+			break;
+		}
+		reduce_a = !reduce_a;
+	}
+	if (single) {
+		digit_t x = (digit_t)(a >> digit_len / 2), y = (digit_t)(b >> digit_len / 2);
+		while (true) {
+			digit_t &num = reduce_a ? x : y, &den = reduce_a ? y : x;
+			digit_t &col0 = reduce_a ? u01 : u00, &col1 = reduce_a ? u11 : u10;
+			digit_t row0 = reduce_a ? u00 : u01, row1 = reduce_a ? u10 : u11;
+			num -= den;
+			if (num < min_single) {
+				break;
+			}
+			digit_t q = 1;
+			if (num > den) {
+				q = smallQuotient(num, den);
+				num -= q * den;
+				if (num >= min_single) {
+					q++;
+				}
+			}
+			col0 += q * row0;
+			col1 += q * row1;
+			if (num < min_single) {
+				break;
+			}
+			reduce_a = !reduce_a;
+		}
+	}
+	mat = lehmer_t { u00, u01, u10, u11 };
+	return true;
+}
+hugeint::double_t hugeint::leadingBits (const digit_t *num, size_t size, size_t shift) {
+	// The 2 * digit_len bits of a number of size digits from the bit shift up
+	size_t index = shift >> digit_log_len;
+	int bit = shift & (digit_len - 1);
+	digit_t low = index < size ? num[index] : 0;
+	digit_t mid = index + 1 < size ? num[index + 1] : 0;
+	digit_t high = index + 2 < size ? num[index + 2] : 0;
+	double_t ans = ((double_t)mid << digit_len | low) >> bit;
+	if (bit) {
+		ans |= (double_t)high << (2 * digit_len - bit);
+	}
+	return ans;
+}
+void hugeint::gcdStep (hugeint &a, hugeint &b, hugeint &temp, gcd_matrix_t *mat) {
+	// For a >= b > 0 and a of at least 3 digits, a Lehmer step with the cofactors of the leading bits, which takes
+	// about half a digit off both, or a division step when they don't allow any. a >= b is kept
+	size_t shift = a.size() - 2 * digit_len;
+	lehmer_t step;
+	if (!lehmerMatrix(step, leadingBits(a.digits.data(), a.digits.size(), shift), leadingBits(b.digits.data(), b.digits.size(), shift))) {
+		calculateDivMod(a, b, &temp, &a);
+		std::swap(a, b);
+		if (mat) {
+			mat->divStep(temp);
+		}
+		return;
+	}
+	// (u11 * a - u01 * b, u00 * b - u10 * a), which are not negative and not longer than a, so the carries out of the
+	// products cancel
+	size_t size = a.digits.size();
+	b.digits.resize(size, 0);
+	temp.digits.resize(size);
+	multDigit(temp.digits.data(), a.digits.data(), size, step.u11);
+	subMultDigit(temp.digits.data(), b.digits.data(), size, step.u01);
+	multDigit(b.digits.data(), b.digits.data(), size, step.u00);
+	subMultDigit(b.digits.data(), a.digits.data(), size, step.u10);
+	std::swap(a.digits, temp.digits);
+	a.clearZeros();
+	b.clearZeros();
+	if (mat) {
+		mat->lehmerStep(step, temp);
+	}
+	if (a < b) {
+		std::swap(a, b);
+		if (mat) {
+			mat->swapStep();
+		}
+	}
+}
+void hugeint::halfGcdApply (hugeint &a, hugeint &b, size_t shift, const hugeint &a_high, const hugeint &b_high, gcd_matrix_t &mat) {
+	// (a, b) = mat ^ -1 * (a, b), where mat took (a >> shift, b >> shift) to (a_high, b_high), so only the low bits
+	// need the products: the inverse is (m11, -m01; -m10, m00) times the determinant
+	size_t low_size = (shift + digit_len - 1) >> digit_log_len;
+	hugeint a_low, b_low;
+	a_low.digits.assign(a.digits.begin(), a.digits.begin() + std::min(low_size, a.digits.size()));
+	b_low.digits.assign(b.digits.begin(), b.digits.begin() + std::min(low_size, b.digits.size()));
+	if (shift & (digit_len - 1)) {
+		digit_t mask = ((digit_t)1 << (shift & (digit_len - 1))) - 1;
+		if (a_low.digits.size() == low_size) {
+			a_low.digits.back() &= mask;
+		}
+		if (b_low.digits.size() == low_size) {
+			b_low.digits.back() &= mask;
+		}
+	}
+	a_low.clearZeros();
+	b_low.clearZeros();
+	hugeint a_fix = mat.m11 * a_low - mat.m01 * b_low, b_fix = mat.m00 * b_low - mat.m10 * a_low;
+	if (mat.det_neg) {
+		a_fix.negate();
+		b_fix.negate();
+	}
+	a = (a_high << shift) + a_fix;
+	b = (b_high << shift) + b_fix;
+	// Cofactors found on the leading bits can overshoot by a step, the signs and the order are fixed by negating or
+	// swapping columns of the matrix, which keeps it unimodular and so keeps the gcd
+	if (a.neg) {
+		a.negate();
+		mat.m00.negate();
+		mat.m10.negate();
+		mat.det_neg = !mat.det_neg;
+	}
+	if (b.neg) {
+		b.negate();
+		mat.m01.negate();
+		mat.m11.negate();
+		mat.det_neg = !mat.det_neg;
+	}
+	if (a < b) {
+		std::swap(a, b);
+		std::swap(mat.m00, mat.m01);
+		std::swap(mat.m10, mat.m11);
+		mat.det_neg = !mat.det_neg;
+	}
+}
+void hugeint::halfGcd (hugeint &a, hugeint &b, gcd_matrix_t &mat) {
+	// Reduces a >= b >= 0 of n bits until b has at most n / 2 + 1 bits, with mat holding the steps taken. The top half
+	// is reduced recursively to a quarter of its size, the same cofactors take the whole numbers to 3 / 4 of theirs,
+	// and a second recursive call on the top of what is left takes them to the half. Each call costs a few products
+	// of the size of its numbers, so the whole gcd takes O(M(n) log n)
+	size_t bits = a.size(), target = bits / 2 + 1;
+	mat = gcd_matrix_t();
+	if (b.size() <= target) {
+		return;
+	}
+	hugeint temp;
+	if (a.digits.size() >= std::max(half_gcd_threshold, (size_t)4)) {
+		size_t shift = bits / 2;
+		hugeint a_high = a >> shift, b_high = b >> shift;
+		halfGcd(a_high, b_high, mat);
+		halfGcdApply(a, b, shift, a_high, b_high, mat);
+		if (b.size() > target) {
+			calculateDivMod(a, b, &temp, &a);
+			std::swap(a, b);
+			mat.divStep(temp);
+		}
+		size_t left = a.size();
+		if (b.size() > target && 2 * target > left) {
+			shift = 2 * target - left;
+			a_high = a >> shift;
+			b_high = b >> shift;
+			gcd_matrix_t next;
+			halfGcd(a_high, b_high, next);
+			halfGcdApply(a, b, shift, a_high, b_high, next);
+			mat.mult(next);
+		}
+	}
+	// The base case and the last few steps after the recursive calls, gathered in a matrix of their own whose entries
+	// are never negative
+	gcd_matrix_t steps;
+	while (b.size() > target) {
+		if (a.digits.size() < 3) {
+			calculateDivMod(a, b, &temp, &a);
+			std::swap(a, b);
+			steps.divStep(temp);
+		}
+		else {
+			gcdStep(a, b, temp, &steps);
+		}
+	}
+	mat.mult(steps);
+}
+size_t hugeint::gcdextScratch (size_t size) {
+	// The numbers and a spare one, the cofactors and a spare one, and the divisor, remainder and quotient of a
+	// division step with the product of the quotient and a cofactor
+	return 3 * size + 3 * (size + 1) + size + 2 * (size + 1) + 2 * size + 1;
+}
+bool hugeint::lehmerGcdext (digit_t *gcd, digit_t *cof, const digit_t *lhs, const digit_t *rhs, size_t size, digit_t *scratch) {
+	// Lehmer steps on the leading bits of a and b, which are not kept in order, and division steps when they don't
+	// allow any. The cofactors of rhs in a and b are kept as magnitudes, the one of a is never positive and the one of
+	// b never negative, so every step only adds to them, and |ua| * b + |ub| * a = lhs keeps them within size digits
+	digit_t *a = scratch, *b = a + size, *temp = b + size;
+	digit_t *ua = temp + size, *ub = ua + size + 1, *utemp = ub + size + 1;
+	digit_t *div = utemp + size + 1, *rem = div + size, *quot = rem + size + 1, *prod = quot + size + 1;
+	std::copy(lhs, lhs + size, a);
+	std::copy(rhs, rhs + size, b);
+	std::fill(ua, ua + 3 * (size + 1), 0);
+	ub[0] = 1;
+	size_t a_size = trimEqual(a, size, (digit_t)0), b_size = trimEqual(b, size, (digit_t)0), u_size = 1;
+	// Applies the inverse of a Lehmer matrix to the cofactors
+	auto lehmerCofactors = [&] (const lehmer_t &step) {
+		double_t top_a = multDigit(utemp, ua, u_size, step.u11);
+		top_a += addMultDigit(utemp, ub, u_size, step.u01);
+		double_t top_b = multDigit(ub, ub, u_size, step.u00);
+		top_b += addMultDigit(ub, ua, u_size, step.u10);
+		std::swap(ua, utemp);
+		ua[u_size] = (digit_t)top_a;
+		ub[u_size] = (digit_t)top_b;
+		u_size += (top_a | top_b) != 0;
+		if ((top_a | top_b) >> digit_len) {
+			ua[u_size] = (digit_t)(top_a >> digit_len);
+			ub[u_size] = (digit_t)(top_b >> digit_len);
+			u_size++;
+		}
+	};
+	// dst += quot * src, for the cofactors of a division step with a quotient of quot_size digits
+	auto addQuotient = [&] (digit_t *dst, const digit_t *src, const digit_t *quot, size_t quot_size) {
+		simpleMult(prod, src, u_size, quot, quot_size);
+		size_t prod_size = trimEqual(prod, u_size + quot_size, (digit_t)0), sum_size = std::max(u_size, prod_size);
+		dst[sum_size] = addDigits(dst, dst, sum_size, prod, prod_size);
+		u_size = std::max(u_size, trimEqual(dst, sum_size + 1, (digit_t)0));
+	};
+
+	lehmer_t step;
+	while (a_size && b_size && std::max(a_size, b_size) > 2) {
+		size_t size_max = std::max(a_size, b_size);
+		digit_t top = (a_size == size_max ? a[size_max - 1] : 0) | (b_size == size_max ? b[size_max - 1] : 0);
+		size_t shift = size_max * digit_len - countLeadingZeros(top) - 2 * digit_len;
+		if (lehmerMatrix(step, leadingBits(a, size_max, shift), leadingBits(b, size_max, shift))) {
+			multDigit(temp, a, size_max, step.u11);
+			subMultDigit(temp, b, size_max, step.u01);
+			multDigit(b, b, size_max, step.u00);
+			subMultDigit(b, a, size_max, step.u10);
+			std::swap(a, temp);
+			a_size = trimEqual(a, size_max, (digit_t)0);
+			b_size = trimEqual(b, size_max, (digit_t)0);
+			lehmerCofactors(step);
+			continue;
+		}
+		// The larger number is divided by the smaller one, normalized for long division
+		bool a_larger = a_size != b_size ? a_size > b_size : !lessDigits(a, b, a_size);
+		digit_t *num = a_larger ? a : b, *den = a_larger ? b : a;
+		size_t &num_size = a_larger ? a_size : b_size, den_size = a_larger ? b_size : a_size, quot_size;
+		if (den_size == 1) {
+			num[0] = divDigit(quot, num, num_size, den[0]);
+			quot_size = num_size;
+		}
+		else {
+			int zeros = countLeadingZeros(den[den_size - 1]);
+			if (zeros) {
+				shiftFwdDigits(div, den, den_size, zeros);
+				rem[num_size] = shiftFwdDigits(rem, num, num_size, zeros);
+			}
+			else {
+				std::copy(den, den + den_size, div);
+				std::copy(num, num + num_size, rem);
+				rem[num_size] = 0;
+			}
+			simpleDiv(quot, rem, num_size + 1, div, den_size);
+			quot_size = num_size + 1 - den_size;
+			if (zeros) {
+				shiftBackDigits(num, rem, den_size, zeros);
+			}
+			else {
+				std::copy(rem, rem + den_size, num);
+			}
+		}
+		std::fill(num + den_size, num + num_size, 0);
+		num_size = trimEqual(num, den_size, (digit_t)0);
+		addQuotient(a_larger ? ua : ub, a_larger ? ub : ua, quot, trimEqual(quot, quot_size, (digit_t)0));
+	}
+
+	if (a_size && b_size) {
+		// The last two digits with exact Euclid steps on built-in integers, gathered in a matrix while its entries fit
+		// in digits
+		double_t x = a[0], y = b[0];
+		if (a_size > 1) {
+			x |= (double_t)a[1] << digit_len;
+		}
+		if (b_size > 1) {
+			y |= (double_t)b[1] << digit_len;
+		}
+		step = lehmer_t { 1, 0, 0, 1 };
+		while (x && y) {
+			bool reduce_a = x >= y;
+			double_t &num = reduce_a ? x : y, den = reduce_a ? y : x;
+			double_t quot_step = smallQuotient(num, den);
+			num -= quot_step * den;
+			digit_t &col0 = reduce_a ? step.u01 : step.u00, &col1 = reduce_a ? step.u11 : step.u10;
+			if (quot_step <= digit_max) {
+				double_t next0 = col0 + quot_step * (reduce_a ? step.u00 : step.u01);
+				double_t next1 = col1 + quot_step * (reduce_a ? step.u10 : step.u11);
+				if (next0 <= digit_max && next1 <= digit_max) {
+					col0 = (digit_t)next0;
+					col1 = (digit_t)next1;
+					continue;
+				}
+			}
+			lehmerCofactors(step);
+			step = lehmer_t { 1, 0, 0, 1 };
+			digit_t quot_digits[2] = { (digit_t)quot_step, (digit_t)(quot_step >> digit_len) };
+			addQuotient(reduce_a ? ua : ub, reduce_a ? ub : ua, quot_digits, quot_digits[1] ? 2 : 1);
+		}
+		lehmerCofactors(step);
+		digit_t *left = x ? a : b;
+		double_t val = x | y;
+		left[0] = (digit_t)val;
+		if (val >> digit_len) {
+			left[1] = (digit_t)(val >> digit_len);
+		}
+		a_size = x ? 1 + (size_t)(val > digit_max) : 0;
+		b_size = y ? 1 + (size_t)(val > digit_max) : 0;
+	}
+
+	bool in_a = !b_size;
+	const digit_t *res = in_a ? a : b, *res_cof = in_a ? ua : ub;
+	size_t res_size = in_a ? a_size : b_size;
+	std::copy(res, res + res_size, gcd);
+	std::fill(gcd + res_size, gcd + size, 0);
+	std::copy(res_cof, res_cof + u_size, cof);
+	std::fill(cof + u_size, cof + size, 0);
+	return in_a;
+}
+void hugeint::gcdCofactor (hugeint &a, hugeint b, hugeint &cof) {
+	// Large numbers are first reduced with half gcds like in calculateGcd, keeping the steps in a matrix, and the
+	// cofactor found for what is left is then taken back through it
+	gcd_matrix_t mat;
+	size_t threshold = std::max(half_gcd_threshold, (size_t)4);
+	bool reduced = std::max(a.digits.size(), b.digits.size()) >= threshold;
+	if (reduced) {
+		if (a < b) {
+			std::swap(a, b);
+			mat.swapStep();
+		}
+		hugeint temp;
+		while ((bool)b && a.digits.size() >= threshold) {
+			if (b.digits.size() >= threshold) {
+				size_t shift = a.size() / 3;
+				hugeint a_high = a >> shift, b_high = b >> shift;
+				gcd_matrix_t step;
+				halfGcd(a_high, b_high, step);
+				if (step.m01 || step.m10) {
+					halfGcdApply(a, b, shift, a_high, b_high, step);
+					mat.mult(step);
+					continue;
+				}
+			}
+			calculateDivMod(a, b, &temp, &a);
+			std::swap(a, b);
+			mat.divStep(temp);
+		}
+	}
+	size_t size = std::max(std::max(a.digits.size(), b.digits.size()), (size_t)1);
+	a.digits.resize(size, 0);
+	b.digits.resize(size, 0);
+	std::vector <digit_t> scratch(2 * size + gcdextScratch(size));
+	bool cof_neg = lehmerGcdext(scratch.data(), scratch.data() + size, a.digits.data(), b.digits.data(), size, scratch.data() + 2 * size);
+	a.clearZeros();
+	b.clearZeros();
+	hugeint gcd, ans;
+	gcd.digits.assign(scratch.begin(), scratch.begin() + size);
+	gcd.clearZeros();
+	ans.digits.assign(scratch.begin() + size, scratch.begin() + 2 * size);
+	ans.clearZeros();
+	if (cof_neg) {
+		ans.negate();
+	}
+	if (reduced) {
+		// gcd = s * a + ans * b, where a and b are the numbers at the start times det * (m11, -m01; -m10, m00)
+		hugeint s = calculateDivExact(gcd - ans * b, a);
+		ans = ans * mat.m00 - s * mat.m01;
+		if (mat.det_neg) {
+			ans.negate();
+		}
+	}
+	a = std::move(gcd);
+	cof = std::move(ans);
+}
+void hugeint::calculateGcd (hugeint other) {
+	// Large numbers are reduced by a third at a time with the half gcd of their top 2 / 3, smaller ones by about a digit
+	// at a time with Lehmer steps, and the last two digits with built-in integers
+	hugeint &a = *this, &b = other;
+	if (a.neg) {
+		a.negate();
+	}
+	if (b.neg) {
+		b.negate();
+	}
+	if (a < b) {
+		std::swap(a, b);
+	}
+	hugeint temp;
+	while ((bool)b && a.digits.size() > 2) {
+		if (b.digits.size() >= std::max(half_gcd_threshold, (size_t)4)) {
+			size_t shift = a.size() / 3;
+			hugeint a_high = a >> shift, b_high = b >> shift;
+			gcd_matrix_t mat;
+			halfGcd(a_high, b_high, mat);
+			if (mat.m01 || mat.m10) {
+				halfGcdApply(a, b, shift, a_high, b_high, mat);
+				continue;
+			}
+		}
+		gcdStep(a, b, temp, nullptr);
+	}
+	if (!b) {
+		return;
+	}
+	double_t x = 0, y = 0;
+	for (size_t index = a.digits.size(); index > 0; index--) {
+		x = x << digit_len | a.digits[index - 1];
+	}
+	for (size_t index = b.digits.size(); index > 0; index--) {
+		y = y << digit_len | b.digits[index - 1];
+	}
+	while (y) {
+		x %= y;
+		std::swap(x, y);
+	}
+	a.digits = { (digit_t)x, (digit_t)(x >> digit_len) };
+	a.clearZeros();
+}
+void hugeint::calculateLcm (const hugeint &other) {
+	// |this| / gcd * |other|, which is 0 when either of them is
+	hugeint gcd = *this;
+	gcd.calculateGcd(other);
+	if (!gcd) {
+		return;
+	}
+	*this = calculateMult(calculateDivExact(abs(*this), gcd), abs(other));
+}
+hugeint hugeint::calculateGcdext (const hugeint &lhs, const hugeint &rhs, hugeint &s, hugeint &t) {
+	// The cofactor of |rhs| comes from the gcd steps, the one of |lhs| from an exact division, and the signs of the
+	// numbers are moved to their cofactors. The gcd steps only fix the cofactor of |rhs| modulo |lhs| / gcd, and
+	// neither the Lehmer loop nor the half gcd matrix keep it minimal, so it is taken into
+	// (-|lhs| / (2 * gcd), |lhs| / (2 * gcd)], which also bounds the other one by |rhs| / (2 * gcd)
+	hugeint gcd = abs(lhs), rhs_abs = abs(rhs), cof;
+	gcdCofactor(gcd, rhs_abs, cof);
+	hugeint lhs_cof;
+	if (lhs) {
+		hugeint lhs_abs = abs(lhs), period = calculateDivExact(lhs_abs, gcd);
+		calculateDivMod(cof, period, nullptr, &cof, round_floor);
+		if (cof + cof > period) {
+			cof -= period;
+		}
+		lhs_cof = calculateDivExact(gcd - cof * rhs_abs, lhs_abs);
+	}
+	if (lhs.neg) {
+		lhs_cof.negate();
+	}
+	if (rhs.neg) {
+		cof.negate();
+	}
+	s = std::move(lhs_cof);
+	t = std::move(cof);
+	return gcd;
+}
+void hugeint::calculateInvertMod (const hugeint &modulo) {
+	// The cofactor of the number in gcd(|modulo|, number) = 1
+	hugeint mod = abs(modulo);
+	if (!mod) {
+		throw (std::invalid_argument("Division by 0"));
+	}
+	calculateDivMod(*this, mod, nullptr, this, round_floor);
+	hugeint gcd = mod, cof;
+	gcdCofactor(gcd, *this, cof);
+	if (gcd != 1) {
+		throw (std::invalid_argument("Not invertible"));
+	}
+	if (cof.neg) {
+		cof += mod;
+	}
+	*this = std::move(cof);
+}
+
+void hugeint::calculatePow (exp_t exponent) {
+	if (exponent == 0) {
+		neg = false;
+		digits.clear();
+		digits.push_back(1);
+		return;
+	}
+	while (!(exponent & 1) && exponent) {
+		exponent >>= 1;
+		*this = calculateSquare(*this);
+	}
+	hugeint power = *this;
+	exponent >>= 1;
+	while (exponent) {
+		power = calculateSquare(power);
+		if (exponent & 1) {
+			*this = calculateMult(*this, power);
+		}
+		exponent >>= 1;
+	}
+}
+size_t hugeint::powWindow (size_t exp_bits) {
+	// A window of k bits needs 2 ^ (k - 1) products for the table and saves about exp_bits / (k + 1) of them, these
+	// are the bit lengths where one more bit starts to pay off
+	static const size_t limits[] = { 8, 24, 80, 240, 672, 1792, 4608 };
+	size_t window = 1;
+	while (window <= 7 && exp_bits > limits[window - 1]) {
+		window++;
+	}
+	return window;
+}
+template <typename context_t>
+void hugeint::powDigits (const context_t &ctx, digit_t *res, const digit_t *bases, const hugeint *exponents, size_t count, digit_t *scratch) {
+	// Left to right sliding window exponentiation, interleaved over all the bases (Straus). Every base has a table of
+	// its odd powers base ^ 1, base ^ 3, ... up to the window size for the length of its exponent, and every window
+	// of bits starting and ending with 1 becomes one product, made when the shared squarings reach its lowest bit
+	struct window_t {
+		size_t low; // Lowest bit of the window
+		const digit_t *power; // Table entry of its value
+	};
+	size_t size = ctx.size, top = 0;
+	std::vector <std::vector <digit_t>> tables(count);
+	std::vector <std::vector <window_t>> windows(count);
+	for (size_t id = 0; id < count; id++) {
+		const hugeint &exponent = exponents[id];
+		size_t bits = exponent.size(), window = powWindow(bits);
+		if (!bits) {
+			continue;
+		}
+		top = std::max(top, bits);
+		std::vector <digit_t> &table = tables[id];
+		table.resize(size << (window - 1));
+		std::copy(bases + id * size, bases + (id + 1) * size, table.data());
+		if (window > 1) {
+			std::vector <digit_t> square(size);
+			ctx.sqrDigits(square.data(), table.data(), scratch);
+			for (size_t index = 1; index < ((size_t)1 << (window - 1)); index++) {
+				ctx.mulDigits(table.data() + index * size, table.data() + (index - 1) * size, square.data(), scratch);
+			}
+		}
+		for (size_t pos = bits; pos > 0;) {
+			if (!exponent.getBit(pos - 1)) {
+				pos--;
+				continue;
+			}
+			size_t low = pos > window ? pos - window : 0;
+			while (!exponent.getBit(low)) {
+				low++;
+			}
+			size_t value = 0;
+			for (size_t bit = pos; bit > low; bit--) {
+				value = value << 1 | exponent.getBit(bit - 1);
+			}
+			windows[id].push_back(window_t { low, table.data() + (value >> 1) * size });
+			pos = low;
+		}
+	}
+	// The result stays 1 until the first window, so the squarings before it are skipped
+	std::vector <size_t> next(count, 0);
+	bool first = true;
+	for (size_t pos = top; pos > 0; pos--) {
+		if (!first) {
+			ctx.sqrDigits(res, res, scratch);
+		}
+		for (size_t id = 0; id < count; id++) {
+			if (next[id] == windows[id].size() || windows[id][next[id]].low != pos - 1) {
+				continue;
+			}
+			const digit_t *power = windows[id][next[id]++].power;
+			if (first) {
+				std::copy(power, power + size, res);
+				first = false;
+			}
+			else {
+				ctx.mulDigits(res, res, power, scratch);
+			}
+		}
+	}
+	if (first) {
+		ctx.formDigits(res, 1, scratch);
+	}
+}
+template <typename context_t>
+hugeint hugeint::calculatePow (const context_t &ctx, const hugeint &base, const hugeint &exponent, digit_t *scratch) {
+	if (exponent.neg) {
+		throw (std::invalid_argument("Negative exponent"));
+	}
+	// The result keeps the sign of the power like %, so an odd power of a negative number is moved below 0
+	std::vector <digit_t> power(ctx.size);
+	ctx.formDigits(power.data(), base, scratch);
+	powDigits(ctx, power.data(), power.data(), &exponent, 1, scratch);
+	hugeint ans = ctx.valueDigits(power.data());
+	if (base.neg && exponent.getBit(0) && (bool)ans) {
+		ans.calculateAdd(ctx.mod, true);
+	}
+	return ans;
+}
+void hugeint::calculatePow (const hugeint &exponent, const hugeint &to_mod) {
+	// Odd moduli use Montgomery multiplication, the others and the large ones Barrett reduction
+	hugeint mod = abs(to_mod);
+	if (mod.getBit(0) && mod.digits.size() < montgomery_threshold) {
+		montgomery ctx(mod);
+		std::vector <digit_t> scratch(ctx.scratchSize());
+		*this = calculatePow(ctx, *this, exponent, scratch.data());
+	}
+	else {
+		barrett ctx(mod);
+		std::vector <digit_t> scratch(ctx.scratchSize());
+		*this = calculatePow(ctx, *this, exponent, scratch.data());
+	}
+}
+std::vector <hugeint> hugeint::powMod (const std::vector <hugeint> &bases, const std::vector <hugeint> &exponents, const hugeint &modulo) {
+	if (bases.size() != exponents.size()) {
+		throw (std::invalid_argument("Different numbers of bases and exponents"));
+	}
+	hugeint mod = abs(modulo);
+	std::vector <hugeint> ans(bases.size());
+	if (mod.getBit(0) && mod.digits.size() < montgomery_threshold) {
+		montgomery ctx(mod);
+		std::vector <digit_t> scratch(ctx.scratchSize());
+		for (size_t id = 0; id < bases.size(); id++) {
+			ans[id] = calculatePow(ctx, bases[id], exponents[id], scratch.data());
+		}
+	}
+	else {
+		barrett ctx(mod);
+		std::vector <digit_t> scratch(ctx.scratchSize());
+		for (size_t id = 0; id < bases.size(); id++) {
+			ans[id] = calculatePow(ctx, bases[id], exponents[id], scratch.data());
+		}
+	}
+	return ans;
+}
+template <typename context_t>
+hugeint hugeint::calculateMultiPow (const context_t &ctx, const std::vector <hugeint> &bases, const std::vector <hugeint> &exponents) {
+	size_t count = bases.size();
+	std::vector <digit_t> forms(std::max(count, (size_t)1) * ctx.size), scratch(ctx.scratchSize());
+	for (size_t id = 0; id < count; id++) {
+		ctx.formDigits(forms.data() + id * ctx.size, bases[id], scratch.data());
+	}
+	powDigits(ctx, forms.data(), forms.data(), exponents.data(), count, scratch.data());
+	return ctx.valueDigits(forms.data());
+}
+hugeint hugeint::multiPowMod (const std::vector <hugeint> &bases, const std::vector <hugeint> &exponents, const hugeint &modulo) {
+	if (bases.size() != exponents.size()) {
+		throw (std::invalid_argument("Different numbers of bases and exponents"));
+	}
+	for (const hugeint &exponent : exponents) {
+		if (exponent.neg) {
+			throw (std::invalid_argument("Negative exponent"));
+		}
+	}
+	hugeint mod = abs(modulo);
+	if (mod.getBit(0) && mod.digits.size() < montgomery_threshold) {
+		return calculateMultiPow(montgomery(mod), bases, exponents);
+	}
+	return calculateMultiPow(barrett(mod), bases, exponents);
+}
+
+hugeint::barrett::barrett (const hugeint &modulus) : mod(abs(modulus)) {
+	if (!(bool)mod) {
+		throw (std::invalid_argument("Division by 0"));
+	}
+	size = mod.digits.size();
+	hugeint power;
+	power.digits.assign((size << 1) + 1, 0);
+	power.digits.back() = 1;
+	hugeint quot;
+	calculateDivMod(power, mod, &quot, nullptr);
+	// mod has its top digit set, so the reciprocal has at most size + 2 digits
+	recip = quot.digits;
+	recip.resize(size + 2, 0);
+}
+size_t hugeint::barrett::scratchSize () const {
+	// A product to reduce, the quotient estimate, its product with mod and the remainder, then the scratch of the
+	// products
+	size_t prod = size + 3;
+#ifdef DIGIT_64
+	return 7 * size + 8 + multScratch(prod, std::min(prod, ntt_threshold - 1));
+#else
+	return 7 * size + 8 + multScratch(prod, prod);
+#endif
+}
+void hugeint::barrett::mulDigits (digit_t *res, const digit_t *lhs, const digit_t *rhs, digit_t *scratch) const {
+	multAlgorithm(scratch, lhs, size, rhs, size, scratch + (size << 1));
+	reduceDigits(res, scratch, scratch + (size << 1));
+}
+void hugeint::barrett::sqrDigits (digit_t *res, const digit_t *num, digit_t *scratch) const {
+	squareAlgorithm(scratch, num, size, scratch + (size << 1));
+	reduceDigits(res, scratch, scratch + (size << 1));
+}
+void hugeint::barrett::reduceDigits (digit_t *res, const digit_t *num, digit_t *scratch) const {
+	// The quotient estimate floor(floor(num / B ^ (size - 1)) * recip / B ^ (size + 1)) is at most 2 too small, so the
+	// remainder is found from the low size + 1 digits alone and needs at most two subtractions of mod
+	size_t recip_size = recip.size();
+	digit_t *quot = scratch, *prod = quot + size + 1 + recip_size, *rem = prod + (size << 1) + 1, *rest = rem + size + 1;
+	multAlgorithm(quot, num + size - 1, size + 1, recip.data(), recip_size, rest);
+	multAlgorithm(prod, quot + size + 1, size + 1, mod.digits.data(), size, rest);
+	subDigits(rem, num, size + 1, prod, size + 1);
+	while (rem[size] || !lessDigits(rem, mod.digits.data(), size)) {
+		rem[size] -= subDigits(rem, rem, size, mod.digits.data(), size);
+	}
+	std::copy(rem, rem + size, res);
+}
+void hugeint::barrett::formDigits (digit_t *res, const hugeint &num, digit_t *scratch) const {
+	// Barrett reduction works on the numbers themselves, reduced to [0, mod)
+	(void)scratch;
+	hugeint rem = reduce(num);
+	std::copy(rem.digits.begin(), rem.digits.end(), res);
+	std::fill(res + rem.digits.size(), res + size, 0);
+}
+hugeint hugeint::barrett::valueDigits (const digit_t *num) const {
+	hugeint ans;
+	ans.digits.assign(num, num + size);
+	ans.clearZeros();
+	return ans;
+}
+hugeint hugeint::barrett::reduce (const hugeint &num) const {
+	// Chunks of size digits are brought in from the top, each step reduces the remainder so far followed by the chunk
+	hugeint num_abs;
+	const hugeint *calc = &num;
+	if (num.neg) {
+		num_abs = -num;
+		calc = &num_abs;
+	}
+	hugeint ans;
+	ans.digits.assign(size, 0);
+	std::vector <digit_t> cur(size << 1), scratch(scratchSize());
+	size_t pos = calc->digits.size();
+	while (pos) {
+		size_t take = pos % size ? pos % size : size;
+		pos -= take;
+		std::copy(calc->digits.begin() + pos, calc->digits.begin() + pos + take, cur.begin());
+		std::fill(cur.begin() + take, cur.begin() + size, 0);
+		std::copy(ans.digits.begin(), ans.digits.end(), cur.begin() + size);
+		reduceDigits(ans.digits.data(), cur.data(), scratch.data());
+	}
+	ans.clearZeros();
+	if (num.neg && (bool)ans) {
+		ans = mod - ans;
+	}
+	return ans;
+}
+hugeint hugeint::barrett::mulmod (const hugeint &lhs, const hugeint &rhs) const {
+	if (&lhs == &rhs) {
+		return sqrmod(lhs);
+	}
+	// Factors outside [0, mod) are reduced first so the product has at most 2 * size digits
+	hugeint lhs_mod, rhs_mod;
+	const hugeint *calc1 = &lhs, *calc2 = &rhs;
+	if (lhs.neg || lhs.digits.size() > size || (lhs.digits.size() == size && lhs >= mod)) {
+		lhs_mod = reduce(lhs);
+		calc1 = &lhs_mod;
+	}
+	if (rhs.neg || rhs.digits.size() > size || (rhs.digits.size() == size && rhs >= mod)) {
+		rhs_mod = reduce(rhs);
+		calc2 = &rhs_mod;
+	}
+	std::vector <digit_t> prod(size << 1), scratch(scratchSize());
+	multAlgorithm(prod.data(), calc1->digits.data(), calc1->digits.size(), calc2->digits.data(), calc2->digits.size(), scratch.data());
+	hugeint ans;
+	ans.digits.resize(size);
+	reduceDigits(ans.digits.data(), prod.data(), scratch.data());
+	ans.clearZeros();
+	return ans;
+}
+hugeint hugeint::barrett::sqrmod (const hugeint &num) const {
+	hugeint num_mod;
+	const hugeint *calc = &num;
+	if (num.neg || num.digits.size() > size || (num.digits.size() == size && num >= mod)) {
+		num_mod = reduce(num);
+		calc = &num_mod;
+	}
+	if (!(bool)*calc) {
+		return *calc;
+	}
+	std::vector <digit_t> prod(size << 1), scratch(scratchSize());
+	squareAlgorithm(prod.data(), calc->digits.data(), calc->digits.size(), scratch.data());
+	hugeint ans;
+	ans.digits.resize(size);
+	reduceDigits(ans.digits.data(), prod.data(), scratch.data());
+	ans.clearZeros();
+	return ans;
+}
+
+hugeint::montgomery::montgomery (const hugeint &modulus) : mod(abs(modulus)) {
+	if (!mod.getBit(0)) {
+		throw (std::invalid_argument("Montgomery modulus must be odd"));
+	}
+	size = mod.digits.size();
+	inv = 0 - invertOdd(mod.digits[0]);
+	hugeint power, rem;
+	power.digits.assign(size + 1, 0);
+	power.digits.back() = 1;
+	calculateDivMod(power, mod, nullptr, &rem);
+	one = rem.digits;
+	one.resize(size, 0);
+	rem = calculateSquare(rem);
+	calculateDivMod(rem, mod, nullptr, &rem);
+	square = rem.digits;
+	square.resize(size, 0);
+}
+size_t hugeint::montgomery::scratchSize () const {
+	// The product to reduce and the scratch to compute it
+#ifdef DIGIT_64
+	return (size << 1) + multScratch(size, std::min(size, ntt_threshold - 1));
+#else
+	return (size << 1) + multScratch(size, size);
+#endif
+}
+void hugeint::montgomery::redcDigits (digit_t *res, digit_t *num) const {
+	// Each step adds the multiple of mod that clears the lowest digit, its carry is kept in that digit and all of
+	// them are added at the end (like GMP's redc_1)
+	for (size_t index = 0; index < size; index++) {
+		num[index] = addMultDigit(num + index, mod.digits.data(), size, num[index] * inv);
+	}
+	// The sum is below 2 * mod, so it needs at most one subtraction
+	digit_t carry = addDigits(res, num + size, size, num, size);
+	if (carry || !lessDigits(res, mod.digits.data(), size)) {
+		subDigits(res, res, size, mod.digits.data(), size);
+	}
+}
+void hugeint::montgomery::mulDigits (digit_t *res, const digit_t *lhs, const digit_t *rhs, digit_t *scratch) const {
+	multAlgorithm(scratch, lhs, size, rhs, size, scratch + (size << 1));
+	redcDigits(res, scratch);
+}
+void hugeint::montgomery::sqrDigits (digit_t *res, const digit_t *num, digit_t *scratch) const {
+	squareAlgorithm(scratch, num, size, scratch + (size << 1));
+	redcDigits(res, scratch);
+}
+void hugeint::montgomery::loadDigits (digit_t *res, const hugeint &num) const {
+	// num % mod in [0, mod), padded to size digits
+	hugeint rem;
+	const hugeint *calc = &num;
+	if (num.neg || num.digits.size() > size || (num.digits.size() == size && num >= mod)) {
+		calculateDivMod(num, mod, nullptr, &rem, round_floor);
+		calc = &rem;
+	}
+	std::copy(calc->digits.begin(), calc->digits.end(), res);
+	std::fill(res + calc->digits.size(), res + size, 0);
+}
+void hugeint::montgomery::formDigits (digit_t *res, const hugeint &num, digit_t *scratch) const {
+	loadDigits(res, num);
+	mulDigits(res, res, square.data(), scratch);
+}
+hugeint hugeint::montgomery::valueDigits (const digit_t *num) const {
+	std::vector <digit_t> prod(size << 1);
+	std::copy(num, num + size, prod.begin());
+	hugeint ans;
+	ans.digits.resize(size);
+	redcDigits(ans.digits.data(), prod.data());
+	ans.clearZeros();
+	return ans;
+}
+hugeint hugeint::montgomery::toForm (const hugeint &num) const {
+	hugeint ans;
+	ans.digits = modint(*this, num).val;
+	ans.clearZeros();
+	return ans;
+}
+hugeint hugeint::montgomery::fromForm (const hugeint &num) const {
+	std::vector <digit_t> form(size);
+	loadDigits(form.data(), num);
+	return valueDigits(form.data());
+}
+hugeint hugeint::montgomery::mulmod (const hugeint &lhs, const hugeint &rhs) const {
+	std::vector <digit_t> factors(size << 1), scratch(scratchSize());
+	loadDigits(factors.data(), lhs);
+	loadDigits(factors.data() + size, rhs);
+	hugeint ans;
+	ans.digits.resize(size);
+	mulDigits(ans.digits.data(), factors.data(), factors.data() + size, scratch.data());
+	ans.clearZeros();
+	return ans;
+}
+
+hugeint::modint::modint (const montgomery &ctx, const hugeint &num) : ctx(&ctx), val(ctx.size) {
+	std::vector <digit_t> scratch(ctx.scratchSize());
+	ctx.formDigits(val.data(), num, scratch.data());
+}
+void hugeint::modint::checkContext (const modint &other) const {
+	if (ctx != other.ctx) {
+		throw (std::invalid_argument("Residues of different moduli"));
+	}
+}
+hugeint hugeint::modint::value () const {
+	return ctx->valueDigits(val.data());
+}
+hugeint::modint &hugeint::modint::operator+= (const modint &rhs) {
+	checkContext(rhs);
+	const digit_t *mod = ctx->mod.digits.data();
+	digit_t carry = addDigits(val.data(), val.data(), ctx->size, rhs.val.data(), ctx->size);
+	if (carry || !lessDigits(val.data(), mod, ctx->size)) {
+		subDigits(val.data(), val.data(), ctx->size, mod, ctx->size);
+	}
+	return *this;
+}
+hugeint::modint &hugeint::modint::operator-= (const modint &rhs) {
+	checkContext(rhs);
+	if (subDigits(val.data(), val.data(), ctx->size, rhs.val.data(), ctx->size)) {
+		addDigits(val.data(), val.data(), ctx->size, ctx->mod.digits.data(), ctx->size);
+	}
+	return *this;
+}
+hugeint::modint &hugeint::modint::operator*= (const modint &rhs) {
+	checkContext(rhs);
+	std::vector <digit_t> scratch(ctx->scratchSize());
+	ctx->mulDigits(val.data(), val.data(), rhs.val.data(), scratch.data());
+	return *this;
+}
+hugeint::modint hugeint::modint::operator- () const {
+	modint ans(ctx);
+	if (countEqual(val.data(), val.size(), (digit_t)0) < val.size()) {
+		subDigits(ans.val.data(), ctx->mod.digits.data(), ctx->size, val.data(), ctx->size);
+	}
+	return ans;
+}
+hugeint::modint hugeint::modint::inverse () const {
+	// The inverse of the form x * R is x ^ -1 / R, which two products by R ^ 2 take to the form of x ^ -1. Below
+	// half_gcd_threshold digits the inverse is found on the digits directly
+	modint ans(ctx);
+	size_t size = ctx->size;
+	std::vector <digit_t> scratch(std::max(ctx->scratchSize(), size + gcdextScratch(size)));
+	if (size < half_gcd_threshold) {
+		digit_t *gcd = scratch.data();
+		bool cof_neg = lehmerGcdext(gcd, ans.val.data(), ctx->mod.digits.data(), val.data(), size, gcd + size);
+		if (gcd[0] != 1 || countEqual(gcd + 1, size - 1, (digit_t)0) != size - 1) {
+			throw (std::invalid_argument("Not invertible"));
+		}
+		if (cof_neg && countEqual(ans.val.data(), size, (digit_t)0) != size) {
+			subDigits(ans.val.data(), ctx->mod.digits.data(), size, ans.val.data(), size);
+		}
+	}
+	else {
+		hugeint form;
+		form.digits = val;
+		form.clearZeros();
+		form.calculateInvertMod(ctx->mod);
+		ctx->loadDigits(ans.val.data(), form);
+	}
+	ctx->mulDigits(ans.val.data(), ans.val.data(), ctx->square.data(), scratch.data());
+	ctx->mulDigits(ans.val.data(), ans.val.data(), ctx->square.data(), scratch.data());
+	return ans;
+}
+hugeint::modint hugeint::modint::pow (exp_t exponent) const {
+	return pow(hugeint(exponent));
+}
+hugeint::modint hugeint::modint::pow (const hugeint &exponent) const {
+	if (exponent.neg) {
+		throw (std::invalid_argument("Negative exponent"));
+	}
+	modint ans(ctx);
+	std::vector <digit_t> scratch(ctx->scratchSize());
+	powDigits(*ctx, ans.val.data(), val.data(), &exponent, 1, scratch.data());
+	return ans;
+}
+
+hugeint::fixedbase::fixedbase (const hugeint &base, const hugeint &modulus, size_t exp_bits) {
+	// About exp_bits / 4 table entries, up to 256 of them
+	teeth = 1;
+	while (teeth < 8 && ((size_t)4 << teeth) <= exp_bits) {
+		teeth++;
+	}
+	spacing = std::max((exp_bits + teeth - 1) / teeth, (size_t)1);
+	hugeint mod = abs(modulus);
+	if (mod.getBit(0) && mod.digits.size() < montgomery_threshold) {
+		mont.reset(new montgomery(mod));
+		buildTable(*mont, base);
+	}
+	else {
+		bar.reset(new barrett(mod));
+		buildTable(*bar, base);
+	}
+}
+template <typename context_t>
+void hugeint::fixedbase::buildTable (const context_t &ctx, const hugeint &base) {
+	// Entry 2 ^ row is base ^ (2 ^ (row * spacing)), the others the product of the highest such entry below them and
+	// the rest of their rows
+	size = ctx.size;
+	table.resize(size << teeth);
+	std::vector <digit_t> scratch(ctx.scratchSize());
+	digit_t *entry = table.data() + size;
+	ctx.formDigits(entry, base, scratch.data());
+	for (size_t row = 1; row < teeth; row++) {
+		digit_t *next = table.data() + (size << row);
+		std::copy(entry, entry + size, next);
+		for (size_t step = 0; step < spacing; step++) {
+			ctx.sqrDigits(next, next, scratch.data());
+		}
+		entry = next;
+	}
+	for (size_t index = 3; index < ((size_t)1 << teeth); index++) {
+		size_t high = (size_t)1 << (digit_len - 1 - countLeadingZeros((digit_t)index));
+		if (index != high) {
+			ctx.mulDigits(table.data() + index * size, table.data() + high * size, table.data() + (index - high) * size, scratch.data());
+		}
+	}
+}
+template <typename context_t>
+hugeint hugeint::fixedbase::calculatePow (const context_t &ctx, const hugeint &exponent) const {
+	std::vector <digit_t> ans(size), scratch(ctx.scratchSize());
+	if (exponent.size() > teeth * spacing) {
+		powDigits(ctx, ans.data(), table.data() + size, &exponent, 1, scratch.data());
+		return ctx.valueDigits(ans.data());
+	}
+	// Column col of the exponent bits col, col + spacing, col + 2 * spacing, ... is the index of its table entry
+	bool first = true;
+	for (size_t col = spacing; col > 0; col--) {
+		if (!first) {
+			ctx.sqrDigits(ans.data(), ans.data(), scratch.data());
+		}
+		size_t index = 0;
+		for (size_t row = teeth; row > 0; row--) {
+			index = index << 1 | exponent.getBit((row - 1) * spacing + col - 1);
+		}
+		if (!index) {
+			continue;
+		}
+		const digit_t *entry = table.data() + index * size;
+		if (first) {
+			std::copy(entry, entry + size, ans.data());
+			first = false;
+		}
+		else {
+			ctx.mulDigits(ans.data(), ans.data(), entry, scratch.data());
+		}
+	}
+	if (first) {
+		ctx.formDigits(ans.data(), 1, scratch.data());
+	}
+	return ctx.valueDigits(ans.data());
+}
+hugeint hugeint::fixedbase::pow (const hugeint &exponent) const {
+	if (exponent.neg) {
+		throw (std::invalid_argument("Negative exponent"));
+	}
+	return mont ? calculatePow(*mont, exponent) : calculatePow(*bar, exponent);
+}
+
+hugeint hugeint::rootRem (const hugeint &num, root_t degree, hugeint &rem) {
+	// floor(num ^ (1 / degree)) for num > 0 and degree > 1. The root of num >> (degree * drop) gives the top half of
+	// the bits of the root, and a Newton step x - (x ^ degree - num) / (degree * x ^ (degree - 1)) from just above the
+	// root doubles them, so the whole root costs about as much as the last step. On integers Newton steps never go
+	// below the root, so the result only has to be fixed by stepping down
+	size_t bits = num.size();
+	if (degree >= bits) {
+		rem = num - 1;
+		return 1;
+	}
+	size_t root_bits = (bits - 1) / degree + 1, degree_bits = 64 - countLeadingZeros((uint64_t)degree);
+	auto newtonStep = [&] (const hugeint &x) {
+		return (x * (degree - 1) + num / pow(x, degree - 1)) / degree;
+	};
+	hugeint ans;
+	if (root_bits <= 32 || root_bits < degree_bits + 6) {
+		// A floating point estimate from the top 64 bits, raised slightly so it is above the root, and Newton steps
+		// until they are within a couple of it
+		size_t shift = bits > 64 ? bits - 64 : 0;
+		double est = std::exp2((std::log2((double)(uint64_t)(num >> shift)) + shift) / degree) * (1 + 1e-9) + 2;
+		ans = est < 0x1p63 ? hugeint((uint64_t)est) : hugeint(est);
+		while (true) {
+			hugeint next = newtonStep(ans);
+			if (next >= ans) {
+				break;
+			}
+			bool close = ans - next <= 2;
+			ans = std::move(next);
+			if (close) {
+				break;
+			}
+		}
+	}
+	else {
+		// The error of the step is about (degree - 1) / 2 * 2 ^ (2 * drop - root_bits), below 1
+		size_t drop = (root_bits - degree_bits) / 2 - 1;
+		hugeint top_rem;
+		ans = newtonStep((rootRem(num >> (degree * drop), degree, top_rem) + 1) << drop);
+	}
+	hugeint power = pow(ans, degree);
+	while (power > num) {
+		ans -= 1;
+		power = pow(ans, degree);
+	}
+	rem = num - power;
+	return ans;
+}
+hugeint hugeint::sqrtRem (const hugeint &num, hugeint &rem) {
+	// Zimmermann's Karatsuba square root for num > 0. With num split as a3 a2 a1 a0 into parts of half bits each, the
+	// top one taking what is left, the root s' and remainder r' of a3 a2 give the top of the root, and the next half
+	// bits are the quotient q of r' a1 by 2 * s'. Then s' q is the root and r a0 - q ^ 2 the remainder, or they are at
+	// most one step too large. Seen from the bit length rounded up to even, num is normalized (at least a quarter of
+	// the power of 2 above it), and so is a3 a2, which the correction relies on
+	size_t bits = num.size();
+	if (num.digits.size() < std::max(sqrt_threshold, (size_t)4)) {
+		return rootRem(num, 2, rem);
+	}
+	size_t half = (bits + (bits & 1)) / 4;
+	hugeint top = num >> (2 * half), mid = num >> half;
+	hugeint ans = sqrtRem(top, rem);
+	hugeint a1 = mid - (top << half), a0 = num - (mid << half);
+	hugeint quot, quot_rem;
+	divmod((rem << half) + a1, ans << 1, quot, quot_rem);
+	ans = (ans << half) + quot;
+	rem = (quot_rem << half) + a0 - quot * quot;
+	while (rem < 0) {
+		rem += (ans << 1) - 1;
+		ans -= 1;
+	}
+	return ans;
+}
+void hugeint::calculateNthRoot (root_t degree, hugeint *rem) {
+	// Odd roots of negative numbers are the negated roots of their absolute values, so they are rounded toward 0 and
+	// the remainder has the sign of the number
+	if (!degree) {
+		throw (std::invalid_argument("Root of degree 0"));
+	}
+	bool was_neg = neg;
+	if (was_neg) {
+		if (!(degree & 1)) {
+			throw (std::invalid_argument("Even root of a negative number"));
+		}
+		negate();
+	}
+	hugeint ans, ans_rem;
+	if (!*this || degree == 1) {
+		ans = *this;
+	}
+	else if (degree == 2) {
+		ans = sqrtRem(*this, ans_rem);
+	}
+	else {
+		ans = rootRem(*this, degree, ans_rem);
+	}
+	if (was_neg) {
+		ans.negate();
+		ans_rem.negate();
+	}
+	*this = std::move(ans);
+	if (rem) {
+		*rem = std::move(ans_rem);
+	}
+}
+
+namespace {
+// Odd prime factors of 2 ^ 64 - 1, whose residues all come from a single pass of additions
+const uint64_t mersenne_primes[] = { 3, 5, 17, 257, 641, 65537, 6700417 };
+// Bit i is set if i is a square modulo 64
+const uint64_t square_mod_64 = 0x202021202030213;
+
+// The magnitude on size digits modulo 2 ^ 64 - 1. Since 2 ^ 64 is 1 modulo it, the digits are added as 64 bit words
+// with the carries wrapped around
+template <typename digit_t>
+uint64_t residue64 (const digit_t *src, size_t size) {
+	uint64_t sum = 0;
+	for (size_t index = 0; index < size; index++) {
+		uint64_t word = (uint64_t)src[index] << (index * sizeof(digit_t) * 8 % 64);
+		sum += word;
+		sum += sum < word;
+	}
+	return sum == UINT64_MAX ? 0 : sum;
+}
+// base ^ exp % mod for mod < 2 ^ 32
+uint64_t powModSmall (uint64_t base, uint64_t exp, uint64_t mod) {
+	uint64_t ans = 1 % mod;
+	base %= mod;
+	for (; exp; exp >>= 1) {
+		if (exp & 1) {
+			ans = ans * base % mod;
+		}
+		base = base * base % mod;
+	}
+	return ans;
+}
+// Whether res is a power of degree modulo prime, by Euler's criterion. When degree doesn't divide prime - 1 every
+// residue is one
+bool powerResidue (uint64_t res, uint64_t prime, uint64_t degree) {
+	res %= prime;
+	return !res || (prime - 1) % degree || powModSmall(res, (prime - 1) / degree, prime) == 1;
+}
+// Primes below limit
+std::vector <uint32_t> sievePrimes (uint32_t limit) {
+	std::vector <bool> composite(limit);
+	std::vector <uint32_t> primes;
+	for (uint32_t num = 2; num < limit; num++) {
+		if (!composite[num]) {
+			primes.push_back(num);
+			for (uint32_t mult = num * num; mult < limit; mult += num) {
+				composite[mult] = true;
+			}
+		}
+	}
+	return primes;
+}
+bool smallPrime (uint64_t num) {
+	for (uint64_t div = 2; div * div <= num; div++) {
+		if (num % div == 0) {
+			return false;
+		}
+	}
+	return num >= 2;
+}
+}
+
+bool hugeint::perfectSquare (const hugeint &num) {
+	// Squares are 12 of the 64 residues modulo 64 and about half of those modulo each prime factor of 2 ^ 64 - 1, so
+	// only about 1 in 400 numbers that aren't squares get to the square root
+	if (!num) {
+		return true;
+	}
+	if (!((square_mod_64 >> (num.digits[0] & 63)) & 1)) {
+		return false;
+	}
+	uint64_t res = residue64(num.digits.data(), num.digits.size());
+	for (uint64_t prime : mersenne_primes) {
+		if (!powerResidue(res, prime, 2)) {
+			return false;
+		}
+	}
+	hugeint rem;
+	sqrtRem(num, rem);
+	return !rem;
+}
+bool hugeint::oddPerfectPower (const hugeint &num, root_t degree, uint64_t res, double log) {
+	// For odd num and odd prime degree. res is num modulo 2 ^ 64 - 1 and log its base 2 logarithm. A root of up to 32
+	// bits must be within rounding errors of an integer, which log tells, and its power must have the residue of num
+	// modulo 2 ^ 32 - 1, so almost no other number gets to the power. Otherwise residues modulo primes one more than a
+	// multiple of degree, of which only 1 in degree is a power of degree, rule out most numbers. For the rest, num has
+	// a single root of degree modulo 2 ^ k, found with Newton's method on 2-adic numbers, first for
+	// num ^ (-1 / degree) and then multiplied by num ^ ((degree - 1) / degree). If num is a power, its root has
+	// exactly root_bits bits and is the root modulo 2 ^ root_bits, so a root of another length or with the wrong
+	// residue modulo 2 ^ 32 - 1 rules it out before the power is computed
+	const uint64_t mod32 = 0xffffffff;
+	size_t bits = num.size(), root_bits = (bits - 1) / degree + 1;
+	if (root_bits <= 32) {
+		double est = std::exp2(log / degree);
+		uint64_t root = (uint64_t)std::nearbyint(est);
+		if (std::fabs(est - root) > 1e-3 || powModSmall(root % mod32, degree, mod32) != res % mod32) {
+			return false;
+		}
+		return pow(hugeint(root), degree) == num;
+	}
+	for (uint64_t prime : mersenne_primes) {
+		if (!powerResidue(res, prime, degree)) {
+			return false;
+		}
+	}
+	size_t found = 0;
+	for (uint64_t prime = 2 * degree + 1; found < 3 && prime <= digit_max; prime += 2 * degree) {
+		if (smallPrime(prime)) {
+			found++;
+			if (!powerResidue(modDigit(num.digits.data(), num.digits.size(), (digit_t)prime), prime, degree)) {
+				return false;
+			}
+		}
+	}
+	auto lowBits = [] (const hugeint &val, size_t count) {
+		return val & ((hugeint(1) << count) - 1);
+	};
+	auto powLow = [&] (hugeint base, root_t exp, size_t count) {
+		hugeint ans = 1;
+		for (; exp; exp >>= 1) {
+			if (exp & 1) {
+				ans = lowBits(ans * base, count);
+			}
+			base = lowBits(base * base, count);
+		}
+		return ans;
+	};
+	std::vector <size_t> precisions;
+	for (size_t count = root_bits; count > 1; count = (count + 1) / 2) {
+		precisions.push_back(count);
+	}
+	hugeint low = lowBits(num, root_bits), inv = 1;
+	hugeint degree_inv = invertMod(hugeint(degree), hugeint(1) << root_bits);
+	for (size_t index = precisions.size() - 1; index < precisions.size(); index--) {
+		size_t count = precisions[index];
+		hugeint err = lowBits(low * powLow(inv, degree, count), count) - 1;
+		inv = lowBits(inv - lowBits(inv * err, count) * lowBits(degree_inv, count), count);
+	}
+	hugeint root = lowBits(low * powLow(inv, degree - 1, root_bits), root_bits);
+	if (root.size() != root_bits) {
+		return false;
+	}
+	uint64_t root_res = residue64(root.digits.data(), root.digits.size());
+	if (powModSmall(root_res % mod32, degree, mod32) != res % mod32) {
+		return false;
+	}
+	return pow(root, degree) == num;
+}
+bool hugeint::isPerfectSquare () const {
+	return !neg && perfectSquare(*this);
+}
+bool hugeint::isPerfectPower () const {
+	// num = 2 ^ zeros * odd is a power of prime degree if degree divides zeros and odd is a power of degree. Prime
+	// degrees are enough, and only odd ones for negative numbers
+	hugeint odd = abs(*this);
+	if (odd <= 1) {
+		return true;
+	}
+	size_t zeros = 0;
+	while (!odd.digits[zeros >> digit_log_len]) {
+		zeros += digit_len;
+	}
+	while (!((odd.digits[zeros >> digit_log_len] >> (zeros & (digit_len - 1))) & 1)) {
+		zeros++;
+	}
+	odd.shiftBack(zeros);
+	if (!neg && !(zeros & 1) && perfectSquare(odd)) {
+		return true;
+	}
+	uint64_t res = residue64(odd.digits.data(), odd.digits.size());
+	size_t shift = odd.size() > 64 ? odd.size() - 64 : 0;
+	double log = std::log2((double)(uint64_t)(odd >> shift)) + shift;
+	// An odd root is at least 3, so the degree is at most log / log2(3), with a step of margin for rounding
+	size_t limit = odd == 1 ? zeros : (size_t)(log / std::log2(3.0)) + 1;
+	for (uint32_t degree : sievePrimes(limit + 1)) {
+		if (degree > 2 && !(zeros % degree) && oddPerfectPower(odd, degree, res, log)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+namespace {
+// Primes below trial_limit, every composite below its square has one of them as a factor
+const uint32_t trial_limit = 1000;
+const std::vector <uint32_t> trial_primes = sievePrimes(trial_limit);
+// Consecutive odd trial primes [begin, end) whose product fits in a digit
+struct prime_group_t {
+	uint64_t product;
+	size_t begin, end;
+};
+std::vector <prime_group_t> groupPrimes (uint64_t max) {
+	std::vector <prime_group_t> groups;
+	for (size_t index = 1; index < trial_primes.size(); index = groups.back().end) {
+		prime_group_t group = { 1, index, index };
+		while (group.end < trial_primes.size() && group.product <= max / trial_primes[group.end]) {
+			group.product *= trial_primes[group.end++];
+		}
+		groups.push_back(group);
+	}
+	return groups;
+}
+// Jacobi symbol (num / mod) for odd mod
+int jacobiSmall (uint64_t num, uint64_t mod) {
+	int ans = 1;
+	num %= mod;
+	while (num) {
+		while (!(num & 1)) {
+			num >>= 1;
+			if ((mod & 7) == 3 || (mod & 7) == 5) {
+				ans = -ans;
+			}
+		}
+		std::swap(num, mod);
+		if ((num & 3) == 3 && (mod & 3) == 3) {
+			ans = -ans;
+		}
+		num %= mod;
+	}
+	return mod == 1 ? ans : 0;
+}
+}
+
+void hugeint::trialResidues (const hugeint &num, std::vector <uint32_t> &res) {
+	static const std::vector <prime_group_t> groups = groupPrimes(digit_max);
+	res.resize(trial_primes.size() - 1);
+	for (const prime_group_t &group : groups) {
+		uint64_t rem = modDigit(num.digits.data(), num.digits.size(), (digit_t)group.product);
+		for (size_t index = group.begin; index < group.end; index++) {
+			res[index - 1] = rem % trial_primes[index];
+		}
+	}
+}
+template <typename context_t>
+bool hugeint::bpswTest (const context_t &ctx) {
+	// A strong probable prime test to base 2 followed by a strong Lucas test with Selfridge's parameters: the first D
+	// in 5, -7, 9, -11, ... with Jacobi symbol (D / num) = -1, P = 1 and Q = (1 - D) / 4. All the arithmetic is on
+	// residues in the form of ctx, the Lucas sequence is climbed with V(k), V(k + 1) and Q ^ k, which need no halving,
+	// and U(d) = 0 is checked as 2 * V(d + 1) = P * V(d), since D * U(k) = 2 * V(k + 1) - P * V(k)
+	const hugeint &num = ctx.mod;
+	size_t size = ctx.size;
+	const digit_t *mod = num.digits.data();
+	std::vector <digit_t> scratch(ctx.scratchSize()), residues(8 * size);
+	digit_t *one = residues.data(), *minus_one = one + size, *val = minus_one + size, *q = val + size;
+	digit_t *v = q + size, *v_next = v + size, *q_pow = v_next + size, *q_next = q_pow + size;
+	auto add = [&] (digit_t *res, const digit_t *lhs, const digit_t *rhs) {
+		digit_t carry = addDigits(res, lhs, size, rhs, size);
+		if (carry || !lessDigits(res, mod, size)) {
+			subDigits(res, res, size, mod, size);
+		}
+	};
+	auto sub = [&] (digit_t *res, const digit_t *lhs, const digit_t *rhs) {
+		if (subDigits(res, lhs, size, rhs, size)) {
+			addDigits(res, res, size, mod, size);
+		}
+	};
+	auto equal = [&] (const digit_t *lhs, const digit_t *rhs) {
+		return std::equal(lhs, lhs + size, rhs);
+	};
+	auto isZero = [&] (const digit_t *res) {
+		return countEqual(res, size, (digit_t)0) == size;
+	};
+	ctx.formDigits(one, 1, scratch.data());
+	ctx.formDigits(minus_one, num - 1, scratch.data());
+	hugeint odd = num - 1;
+	size_t twos = 0;
+	while (!odd.getBit(twos)) {
+		twos++;
+	}
+	odd >>= twos;
+	ctx.formDigits(val, 2, scratch.data());
+	powDigits(ctx, val, val, &odd, 1, scratch.data());
+	bool probable = equal(val, one) || equal(val, minus_one);
+	for (size_t step = 1; step < twos && !probable; step++) {
+		ctx.sqrDigits(val, val, scratch.data());
+		probable = equal(val, minus_one);
+	}
+	if (!probable) {
+		return false;
+	}
+	// Squares have no D with symbol -1
+	if (perfectSquare(num)) {
+		return false;
+	}
+	int64_t disc = 5;
+	while (true) {
+		uint64_t abs_disc = disc < 0 ? -disc : disc;
+		int symbol = jacobiSmall(modDigit(num.digits.data(), num.digits.size(), (digit_t)abs_disc), abs_disc);
+		if ((abs_disc & 3) == 3 && (num.digits[0] & 3) == 3) {
+			symbol = -symbol;
+		}
+		if (disc < 0 && (num.digits[0] & 3) == 3) {
+			symbol = -symbol;
+		}
+		if (!symbol) {
+			return false;
+		}
+		if (symbol < 0) {
+			break;
+		}
+		disc = disc < 0 ? 2 - disc : -2 - disc;
+	}
+	ctx.formDigits(q, hugeint((1 - disc) / 4), scratch.data());
+	odd = num + 1;
+	twos = 0;
+	while (!odd.getBit(twos)) {
+		twos++;
+	}
+	odd >>= twos;
+	add(v, one, one);
+	std::copy(one, one + size, v_next);
+	std::copy(one, one + size, q_pow);
+	for (size_t pos = odd.size() - 1; pos < odd.size(); pos--) {
+		if (odd.getBit(pos)) {
+			ctx.mulDigits(q_next, q_pow, q, scratch.data());
+			ctx.mulDigits(v, v, v_next, scratch.data());
+			sub(v, v, q_pow);
+			ctx.sqrDigits(v_next, v_next, scratch.data());
+			sub(v_next, v_next, q_next);
+			sub(v_next, v_next, q_next);
+			ctx.mulDigits(q_pow, q_pow, q_next, scratch.data());
+		}
+		else {
+			ctx.mulDigits(v_next, v, v_next, scratch.data());
+			sub(v_next, v_next, q_pow);
+			ctx.sqrDigits(v, v, scratch.data());
+			sub(v, v, q_pow);
+			sub(v, v, q_pow);
+			ctx.sqrDigits(q_pow, q_pow, scratch.data());
+		}
+	}
+	add(v_next, v_next, v_next);
+	if (isZero(v) || equal(v_next, v)) {
+		return true;
+	}
+	for (size_t step = 1; step < twos; step++) {
+		ctx.sqrDigits(v, v, scratch.data());
+		sub(v, v, q_pow);
+		sub(v, v, q_pow);
+		ctx.sqrDigits(q_pow, q_pow, scratch.data());
+		if (isZero(v)) {
+			return true;
+		}
+	}
+	return false;
+}
+bool hugeint::bpswTest (const hugeint &num) {
+	// Montgomery reduction below montgomery_threshold digits and Barrett reduction above it, like powMod
+	if (num.digits.size() < montgomery_threshold) {
+		return bpswTest(montgomery(num));
+	}
+	return bpswTest(barrett(num));
+}
+bool hugeint::isProbablePrime () const {
+	// Trial division rules out about 84% of odd numbers before the Baillie-PSW test
+	if (*this < 2) {
+		return false;
+	}
+	if (!getBit(0)) {
+		return *this == 2;
+	}
+	std::vector <uint32_t> res;
+	trialResidues(*this, res);
+	for (size_t index = 0; index < res.size(); index++) {
+		if (!res[index]) {
+			return *this == trial_primes[index + 1];
+		}
+	}
+	return *this < trial_limit * trial_limit || bpswTest(*this);
+}
+void hugeint::calculateNextPrime () {
+	// The residues of the candidate modulo the trial primes are kept up to date as it goes up by 2, so candidates with
+	// a small factor are skipped without a pass over the number and only the others get the Baillie-PSW test
+	if (*this < 2) {
+		*this = 2;
+		return;
+	}
+	*this += getBit(0) ? 2 : 1;
+	if (*this < trial_limit * trial_limit) {
+		while (!isProbablePrime()) {
+			*this += 2;
+		}
+		return;
+	}
+	std::vector <uint32_t> res;
+	trialResidues(*this, res);
+	while (true) {
+		bool small_factor = false;
+		for (uint32_t rem : res) {
+			if (!rem) {
+				small_factor = true;
+				break;
+			}
+		}
+		if (!small_factor && bpswTest(*this)) {
+			return;
+		}
+		*this += 2;
+		for (size_t index = 0; index < res.size(); index++) {
+			res[index] += 2;
+			if (res[index] >= trial_primes[index + 1]) {
+				res[index] -= trial_primes[index + 1];
+			}
 		}
 	}
-	*this = ans;
 }
@@ -0,0 +1,171 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#include "hugeint.h"
+
+// Measures the crossover points of the multiplication algorithms on this machine and writes them to a thresholds
+// file, which the library loads at startup. Usage: tune [output file]
+
+class timer {
+	std::chrono::steady_clock::time_point lastReset;
+public:
+	timer () {
+		lastReset = std::chrono::steady_clock::now();
+	}
+	double reset () {
+		std::chrono::steady_clock::time_point reset_time = std::chrono::steady_clock::now();
+		std::chrono::duration <double> time = std::chrono::duration_cast <std::chrono::duration <double>>(reset_time - lastReset);
+		lastReset = reset_time;
+		return time.count();
+	}
+};
+
+#ifdef DIGIT_64
+const size_t digit_bits = 64;
+#else
+const size_t digit_bits = 32;
+#endif
+
+// Best time of a few runs of op, repeated enough times for each measurement to take about 2 ms
+template <typename Op>
+double bestTime (Op op) {
+	timer clock;
+	size_t reps = 1;
+	while (true) {
+		clock.reset();
+		for (size_t rep = 0; rep < reps; rep++) {
+			op();
+		}
+		if (clock.reset() > 0.002) {
+			break;
+		}
+		reps <<= 1;
+	}
+	double best = 1e18;
+	for (int round = 0; round < 5; round++) {
+		clock.reset();
+		for (size_t rep = 0; rep < reps; rep++) {
+			op();
+		}
+		best = std::min(best, clock.reset() / reps);
+	}
+	return best;
+}
+
+// Product of two random numbers of the given size in digits
+double timeMult (size_t size) {
+	hugeint lhs = hugeint::rand(size * digit_bits, false);
+	hugeint rhs = hugeint::rand(size * digit_bits, false);
+	hugeint ans;
+	return bestTime([&] () { ans = lhs * rhs; });
+}
+double timeSquare (size_t size) {
+	hugeint num = hugeint::rand(size * digit_bits, false);
+	hugeint ans;
+	return bestTime([&] () { ans = num * num; });
+}
+// Division of a random number of twice the size by one of the given size
+double timeDiv (size_t size) {
+	hugeint lhs = hugeint::rand(size * 2 * digit_bits, false);
+	hugeint rhs = hugeint::rand(size * digit_bits, false);
+	hugeint ans;
+	return bestTime([&] () { ans = lhs / rhs; });
+}
+// Division with a quotient 4 times as long as the divisor, the shortest one divided with a reciprocal
+double timeLongDiv (size_t size) {
+	hugeint lhs = hugeint::rand(size * 5 * digit_bits, false);
+	hugeint rhs = hugeint::rand(size * digit_bits, false);
+	hugeint ans;
+	return bestTime([&] () { ans = lhs / rhs; });
+}
+// Modular exponentiation by a 64 bit exponent with an odd modulus of the given size
+double timePowMod (size_t size) {
+	hugeint mod = hugeint::rand(size * digit_bits, false) | 1;
+	hugeint base = hugeint::rand(size * digit_bits, false);
+	hugeint ans;
+	return bestTime([&] () { ans = hugeint::powMod(base, 0xfedcba9876543210ull, mod); });
+}
+// Gcd of two random numbers of the given size
+double timeGcd (size_t size) {
+	hugeint lhs = hugeint::rand(size * digit_bits, false);
+	hugeint rhs = hugeint::rand(size * digit_bits, false);
+	hugeint ans;
+	return bestTime([&] () { ans = hugeint::gcd(lhs, rhs); });
+}
+// Square root of a random number of the given size
+double timeSqrt (size_t size) {
+	hugeint num = hugeint::rand(size * digit_bits, false);
+	hugeint ans;
+	return bestTime([&] () { ans = hugeint::sqrt(num); });
+}
+
+// Finds the smallest size from which turning the algorithm on only for the top level beats leaving it off. The
+// sub-problems are smaller than the size, so they are not affected by the threshold being measured.
+size_t findThreshold (const std::string &name, size_t &threshold, size_t start, size_t limit, double (*measure) (size_t)) {
+	std::cout << name << ": " << std::flush;
+	size_t wins = 0, first_win = limit;
+	for (size_t size = start; size < limit; size += std::max(size / 10, (size_t)1)) {
+		threshold = size + 1;
+		double off = measure(size);
+		threshold = size;
+		double on = measure(size);
+		if (on < off) {
+			if (wins++ == 0) {
+				first_win = size;
+			}
+			// A few wins in a row so a single noisy measurement doesn't decide
+			if (wins == 3) {
+				break;
+			}
+		}
+		else {
+			wins = 0;
+			first_win = limit;
+		}
+	}
+	threshold = first_win;
+	std::cout << threshold << std::endl;
+	return threshold;
+}
+
+int main (int argc, char **argv) {
+	std::string path = argc > 1 ? argv[1] : "hugeint_thresholds.txt";
+	// Tuning always starts from the same state, not from an older thresholds file
+	hugeint::karatsuba_threshold = hugeint::karatsuba_square_threshold = 1000000;
+	hugeint::toom3_threshold = hugeint::toom4_threshold = 1000000;
+	hugeint::burnikel_ziegler_threshold = hugeint::newton_threshold = 1000000;
+	hugeint::half_gcd_threshold = hugeint::sqrt_threshold = 1000000;
+#ifdef DIGIT_64
+	hugeint::ntt_threshold = 1000000;
+#endif
+	hugeint::thread_count = 1;
+
+	findThreshold("karatsuba_threshold", hugeint::karatsuba_threshold, 4, 500, timeMult);
+	findThreshold("karatsuba_square_threshold", hugeint::karatsuba_square_threshold, 4, 500, timeSquare);
+	findThreshold("toom3_threshold", hugeint::toom3_threshold, hugeint::karatsuba_threshold, 2000, timeMult);
+	findThreshold("toom4_threshold", hugeint::toom4_threshold, hugeint::toom3_threshold, 5000, timeMult);
+#ifdef DIGIT_64
+	findThreshold("ntt_threshold", hugeint::ntt_threshold, hugeint::toom4_threshold, 100000, timeMult);
+#endif
+	// Division is built on multiplication, so it is tuned after it
+	findThreshold("burnikel_ziegler_threshold", hugeint::burnikel_ziegler_threshold, 4, 1000, timeDiv);
+	findThreshold("newton_threshold", hugeint::newton_threshold, hugeint::burnikel_ziegler_threshold, 20000, timeLongDiv);
+	// Barrett reduction is the one turned on from montgomery_threshold, Montgomery reduction is used below it
+	findThreshold("montgomery_threshold", hugeint::montgomery_threshold, 4, 1000, timePowMod);
+	findThreshold("half_gcd_threshold", hugeint::half_gcd_threshold, 20, 3000, timeGcd);
+	findThreshold("sqrt_threshold", hugeint::sqrt_threshold, 8, 1000, timeSqrt);
+	size_t cores = std::thread::hardware_concurrency();
+	if (cores > 1) {
+		hugeint::thread_count = cores;
+		findThreshold("parallel_threshold", hugeint::parallel_threshold, 50, 100000, timeMult);
+		hugeint::thread_count = 1;
+	}
+
+	if (!hugeint::saveThresholds(path)) {
+		std::cout << "Couldn't write " << path << std::endl;
+		return 1;
+	}
+	std::cout << "Thresholds written to " << path << std::endl;
+	return 0;
+}